@@ -1,12 +1,13 @@
 #include "AABB.h"
 
-bool AABB::hit(const Ray &ray, double tMin, double tMax) const {
-    double t0x{ (minBound.x - ray.origin.x) * ray.directionReciprocal.x };
-    double t0y{ (minBound.y - ray.origin.y) * ray.directionReciprocal.y };
-    double t0z{ (minBound.z - ray.origin.z) * ray.directionReciprocal.z };
-    double t1x{ (maxBound.x - ray.origin.x) * ray.directionReciprocal.x };
-    double t1y{ (maxBound.y - ray.origin.y) * ray.directionReciprocal.y };
-    double t1z{ (maxBound.z - ray.origin.z) * ray.directionReciprocal.z };
+template <typename T>
+bool AABBT<T>::hit(const RayT<T> &ray, T tMin, T tMax) const {
+    T t0x{ (minBound.x - ray.origin.x) * ray.directionReciprocal.x };
+    T t0y{ (minBound.y - ray.origin.y) * ray.directionReciprocal.y };
+    T t0z{ (minBound.z - ray.origin.z) * ray.directionReciprocal.z };
+    T t1x{ (maxBound.x - ray.origin.x) * ray.directionReciprocal.x };
+    T t1y{ (maxBound.y - ray.origin.y) * ray.directionReciprocal.y };
+    T t1z{ (maxBound.z - ray.origin.z) * ray.directionReciprocal.z };
     if (!ray.xPositive) std::swap(t0x, t1x);
     if (!ray.yPositive) std::swap(t0y, t1y);
     if (!ray.zPositive) std::swap(t0z, t1z);
@@ -15,20 +16,22 @@ bool AABB::hit(const Ray &ray, double tMin, double tMax) const {
     return tMin < tMax;
 }
 
-std::tuple<double, double> AABB::hit(const Ray &ray) const {
-    double t0x{ (minBound.x - ray.origin.x) * ray.directionReciprocal.x };
-    double t0y{ (minBound.y - ray.origin.y) * ray.directionReciprocal.y };
-    double t0z{ (minBound.z - ray.origin.z) * ray.directionReciprocal.z };
-    double t1x{ (maxBound.x - ray.origin.x) * ray.directionReciprocal.x };
-    double t1y{ (maxBound.y - ray.origin.y) * ray.directionReciprocal.y };
-    double t1z{ (maxBound.z - ray.origin.z) * ray.directionReciprocal.z };
+template <typename T>
+std::tuple<T, T> AABBT<T>::hit(const RayT<T> &ray) const {
+    T t0x{ (minBound.x - ray.origin.x) * ray.directionReciprocal.x };
+    T t0y{ (minBound.y - ray.origin.y) * ray.directionReciprocal.y };
+    T t0z{ (minBound.z - ray.origin.z) * ray.directionReciprocal.z };
+    T t1x{ (maxBound.x - ray.origin.x) * ray.directionReciprocal.x };
+    T t1y{ (maxBound.y - ray.origin.y) * ray.directionReciprocal.y };
+    T t1z{ (maxBound.z - ray.origin.z) * ray.directionReciprocal.z };
     if (!ray.xPositive) std::swap(t0x, t1x);
     if (!ray.yPositive) std::swap(t0y, t1y);
     if (!ray.zPositive) std::swap(t0z, t1z);
     return std::make_tuple(std::max(t0x, std::max(t0y, t0z)), std::min(t1x, std::min(t1y, t1z)));
 }
 
-AABB AABB::operator*(const Transformation &trans) const {
+template <typename T>
+AABBT<T> AABBT<T>::operator*(const Transformation &trans) const {
     /*
     Corner notation inside specific int lattice
 
@@ -47,18 +50,21 @@ AABB AABB::operator*(const Transformation &trans) const {
       z
 
     */
-    Vec3 A = minBound, G = maxBound;
-    Vec3 B = Vec3(G.x, A.y, A.z) * trans;
-    Vec3 C = Vec3(G.x, A.y, G.z) * trans;
-    Vec3 D = Vec3(A.x, A.y, G.z) * trans;
-    Vec3 E = Vec3(A.x, G.y, A.z) * trans;
-    Vec3 F = Vec3(G.x, G.y, A.z) * trans;
-    Vec3 H = Vec3(A.x, G.y, G.z) * trans;
+    Vec3T<T> A = minBound, G = maxBound;
+    Vec3T<T> B = Vec3T<T>(G.x, A.y, A.z) * trans;
+    Vec3T<T> C = Vec3T<T>(G.x, A.y, G.z) * trans;
+    Vec3T<T> D = Vec3T<T>(A.x, A.y, G.z) * trans;
+    Vec3T<T> E = Vec3T<T>(A.x, G.y, A.z) * trans;
+    Vec3T<T> F = Vec3T<T>(G.x, G.y, A.z) * trans;
+    Vec3T<T> H = Vec3T<T>(A.x, G.y, G.z) * trans;
     A *= trans;
     G *= trans;
     
-    return AABB(
+    return AABBT(
         minVec3(minVec3(minVec3(minVec3(minVec3(minVec3(minVec3(A, B), C), D), E), F), G), H),
         maxVec3(maxVec3(maxVec3(maxVec3(maxVec3(maxVec3(maxVec3(A, B), C), D), E), F), G), H)
     );
-}
\ No newline at end of file
+}
+
+template struct AABBT<float>;
+template struct AABBT<double>;
@@ -2,52 +2,65 @@
 #include "Ray.h"
 #include <tuple>
 
-struct AABB {
+template <typename T>
+struct AABBT {
     // Acceleration algorithm: Axis-Aligned Bounding Box
-    Vec3 minBound{ INFINITY, INFINITY, INFINITY };
-    Vec3 maxBound{ -INFINITY, -INFINITY, -INFINITY };
-    Vec3 center;
-    double area{ 0.0 };
-    double padding{ 0.00001 };
-
-    AABB() = default;
-    AABB(const Vec3 &min, const Vec3 &max, double pad = 0.00001);
-    bool hit(const Ray &ray, double tMin, double tMax) const;
-    std::tuple<double, double> hit(const Ray &ray) const;
-    AABB operator+(const AABB &b) const;
-    AABB &operator+=(const AABB &b);
-    AABB operator*(const Transformation &trans) const;
-    void expand() { minBound -= Vec3(padding); maxBound += Vec3(padding); }
+    Vec3T<T> minBound{ INFINITY, INFINITY, INFINITY };
+    Vec3T<T> maxBound{ -INFINITY, -INFINITY, -INFINITY };
+    Vec3T<T> center;
+    T area{ 0 };
+    T padding{ T(0.00001) };
+
+    AABBT() = default;
+    AABBT(const Vec3T<T> &min, const Vec3T<T> &max, T pad = T(0.00001));
+    bool hit(const RayT<T> &ray, T tMin, T tMax) const;
+    std::tuple<T, T> hit(const RayT<T> &ray) const;
+    AABBT operator+(const AABBT &b) const;
+    AABBT &operator+=(const AABBT &b);
+    AABBT operator*(const Transformation &trans) const;
+    void expand() { minBound -= Vec3T<T>(padding); maxBound += Vec3T<T>(padding); }
+    T halfArea() const;  // recomputed from bounds, unlike area which is only set on construction
     int longestAxis() const;
-    friend std::ostream &operator<<(std::ostream &os, const AABB &ab);
+    friend std::ostream &operator<<(std::ostream &os, const AABBT &ab) {
+        os << "minBound: " << ab.minBound << ", " << "maxBound: " << ab.maxBound << std::endl;
+        return os;
+    }
 };
 
-inline AABB::AABB(const Vec3 &min, const Vec3 &max, double pad) :
+using AABB = AABBT<Real>;
+
+template <typename T>
+inline AABBT<T>::AABBT(const Vec3T<T> &min, const Vec3T<T> &max, T pad) :
     minBound(min), maxBound(max), padding(pad) {
     expand();
     center = (minBound + maxBound) * 0.5;
     // half area
-    Vec3 len{ maxBound - minBound };
+    Vec3T<T> len{ maxBound - minBound };
     area = len.x * len.y + len.y * len.z + len.z * len.x;
 }
 
-inline AABB AABB::operator+(const AABB &b) const {
-    return AABB(minVec3(minBound, b.minBound), maxVec3(maxBound, b.maxBound));
+template <typename T>
+inline AABBT<T> AABBT<T>::operator+(const AABBT &b) const {
+    return AABBT(minVec3(minBound, b.minBound), maxVec3(maxBound, b.maxBound));
 }
 
-inline AABB &AABB::operator+=(const AABB &b) {
+template <typename T>
+inline AABBT<T> &AABBT<T>::operator+=(const AABBT &b) {
     minBound = minVec3(minBound, b.minBound);
     maxBound = maxVec3(maxBound, b.maxBound);
     return *this;
 }
 
-inline int AABB::longestAxis() const {
-    Vec3 len{ maxBound - minBound };
-    double maxLen{ len.max() };
-    for (int i{ 0 }; i < 3; ++i) if (len[i] == maxLen)return i;
+template <typename T>
+inline T AABBT<T>::halfArea() const {
+    Vec3T<T> len{ maxBound - minBound };
+    if (len.x < 0 || len.y < 0 || len.z < 0) return 0;
+    return len.x * len.y + len.y * len.z + len.z * len.x;
 }
 
-inline std::ostream &operator<<(std::ostream &os, const AABB &ab) {
-    os << "minBound: " << ab.minBound << ", " << "maxBound: " << ab.maxBound << std::endl;
-    return os;
-}
\ No newline at end of file
+template <typename T>
+inline int AABBT<T>::longestAxis() const {
+    Vec3T<T> len{ maxBound - minBound };
+    T maxLen{ len.max() };
+    for (int i{ 0 }; i < 3; ++i) if (len[i] == maxLen)return i;
+}
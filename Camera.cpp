@@ -1,6 +1,10 @@
 #include "Camera.h"
 #include "utility.h"
-#include <omp.h>
+#include "imageIO.h"
+#include <chrono>
+#include <atomic>
+#include <numeric>
+#include <algorithm>
 
 void Camera::initialization() {
     // Right-hand coordinate system
@@ -28,77 +32,447 @@ void Camera::initialization() {
     Primitive::motionBlur = motionBlur;
 }
 
-Vec3 Camera::sampleInCircle() {
-    double radius{ rand01() };
-    double angle{ rand01() * 2.0 * PI };
+Vec3 Camera::sampleInCircle(Sampler &sampler) const {
+    double radius{ sampler.rand01() };
+    double angle{ sampler.rand01() * 2.0 * PI };
     return (right * cos(angle) + up * sin(angle)) * radius * lensRadius;
 }
 
 
-Ray Camera::getRay(double u, double v) {
+Ray Camera::getRay(double u, double v, Sampler &sampler) const {
     // Indices are counted row by row, left to right, top to bottom.
     v = 1.0 - v;
     Vec3 target = leftDownCorner + u * filmWidth * right + v * filmHeight * up;
 
     Vec3 newP{ position };
-    if(aperture >= 0.0) newP += sampleInCircle();
-    if (motionBlur) return Ray(newP, target - newP, timeStart + rand01() * timeIntervel);
+    if(aperture >= 0.0) newP += sampleInCircle(sampler);
+    if (motionBlur) return Ray(newP, target - newP, timeStart + sampler.rand01() * timeIntervel);
     else return Ray(newP, target - newP);
 }
 
-Color Camera::render(const Ray &ray, const BVH &bvh, int depth) const {
+Color Camera::render(const Ray &ray, const Primitive &scene, Sampler &sampler) const {
     HitRec rec;
-    if (bvh.hit(ray, 0.0000001, 1e10, rec)) {
-        Color albedo{ rec.mat->texture->v(rec.uv, rec.p) };
-        if (rec.mat->LIGHT) {
-            if (rec.normal * ray.direction <= 0) return albedo;
-            else return Color();
+    rec.sampler = &sampler;
+    if (scene.hit(ray, RAY_EPSILON, 1e10, rec)) return shade(ray, rec, scene, sampler);
+    else return background(ray);
+}
+
+double Camera::powerHeuristic(double pdfA, double pdfB) {
+    // MIS weight of strategy A, beta = 2.
+    pdfA *= pdfA;
+    pdfB *= pdfB;
+    return pdfA / (pdfA + pdfB);
+}
+
+Color Camera::shade(const Ray &cameraRay, const HitRec &firstHit, const Primitive &scene, Sampler &sampler) const {
+    /*
+        Radiance reaching the camera along a path starting at firstHit, as a loop.
+        throughput: product of reflectance * albedo * eval / PDF of every bounce so far.
+        Russian roulette from rouletteDepth on: a path survives with probability
+            q = min(0.95, max channel of throughput)
+        and survivors are divided by q, so the estimate stays unbiased.
+        Non-specular vertices also sample the light list (directLight). A sampled light hit
+        by the scattered ray then only adds the BSDF sampling share of its emission.
+    */
+    Ray ray{ cameraRay };
+    HitRec rec{ firstHit };
+    Color throughput(1.0), radiance;
+    bool lightSampled{ false };
+    double scatterPDF{ 0.0 };
+    for (int depth{ 0 }; ; ++depth) {
+        const Material &mat{ MaterialTable::get(rec.matId) };
+        Color albedo{ albedoOf(mat, rec) };
+        if (mat.LIGHT) {
+            if (rec.geometricNormal * ray.direction > 0) return radiance;
+            return radiance + throughput * albedo * emissionWeight(ray, rec, lightSampled, scatterPDF);
+        }
+        if (depth >= maxDepth) return radiance;
+
+        lightSampled = directLighting != BSDF_SAMPLING && !mat.SPECULAR && !lights.empty();
+        if (lightSampled) radiance += throughput * albedo * mat.reflectance * directLight(ray, rec, scene, sampler);
+
+        Ray scattered{ scatterOf(mat, ray, rec, scatterPDF, sampler) };
+        if (mat.SPECULAR) throughput *= albedo * mat.reflectance;
+        else {
+            if (scatterPDF <= 0.0) return radiance;
+            double eval{ evalOf(mat, ray, rec, scattered.direction.normalized()) };
+            throughput *= albedo * (mat.reflectance * eval / scatterPDF);
+        }
+        if (rouletteDepth && depth + 1 >= rouletteDepth) {
+            double survival{ std::min(0.95, std::max(throughput.R, std::max(throughput.G, throughput.B))) };
+            if (sampler.rand01() >= survival) return radiance;
+            throughput /= survival;
         }
-        else if (depth < maxDepth) {
-            double PDF;
-            Ray &&scattered{ rec.mat->scatter(ray, rec, PDF) };
-            //return PDF * rec.mat->reflectance * (render(scattered, bvh, ++depth) * albedo);
-            return rec.mat->reflectance * (render(scattered, bvh, ++depth) * albedo);
-        } else return Color();
-    } else return background(ray);
+
+        ray = scattered;
+        rec = HitRec();
+        rec.sampler = &sampler;
+        if (!scene.hit(ray, RAY_EPSILON, 1e10, rec)) return radiance + throughput * background(ray);
+    }
+}
+
+double Camera::lightPdf(const Ray &ray, const HitRec &lightRec) const {
+    // Solid angle density of light sampling for the point ray hit: pdfArea * distance^2 / cosLight.
+    Vec3 toLight{ lightRec.p - ray.origin };
+    double distanceSquared{ toLight * toLight };
+    // The geometric normal, as LightList samples with it: vertex normals would skew the MIS weights.
+    double cosLight{ -(lightRec.geometricNormal * toLight) / std::sqrt(distanceSquared) };
+    return cosLight > 0.0 ? lights.pdfArea() * distanceSquared / cosLight : 0.0;
+}
+
+double Camera::emissionWeight(const Ray &ray, const HitRec &lightRec, bool lightSampled, double scatterPDF) const {
+    // Share of a light's front side emission collected by a scattered ray. The rest came from directLight.
+    if (!lightSampled || !lights.covers(lightRec.matId)) return 1.0;
+    return directLighting == MIS ? powerHeuristic(scatterPDF, lightPdf(ray, lightRec)) : 0.0;
+}
+
+bool Camera::sampleDirectLight(const Ray &ray, const HitRec &rec, Sampler &sampler, Ray &shadowRay, Color &direct) const {
+    /*
+        One light sample for a non-specular vertex, to be multiplied by its albedo and reflectance.
+            Le * eval / lightPDF * weight,  lightPDF = pdfArea * distance^2 / cosLight
+        weight is 1 for LIGHT_SAMPLING, the power heuristic against the material pdf for MIS.
+        Returns false if the sample brings nothing, else direct counts once shadowRay is unblocked
+        up to t = 1, where the light point sits.
+    */
+    const Material &mat{ MaterialTable::get(rec.matId) };
+    LightSample light{ lights.sample(sampler) };
+    Vec3 toLight{ light.p - rec.p };
+    double distanceSquared{ toLight * toLight };
+    double distance{ std::sqrt(distanceSquared) };
+    Vec3 direction{ toLight / distance };
+    double cosLight{ -(light.normal * direction) };
+    if (cosLight <= 0.0) return false;
+    double eval{ evalOf(mat, ray, rec, direction) };
+    if (eval <= 0.0) return false;
+
+    double pdfLight{ lights.pdfArea() * distanceSquared / cosLight };
+    double weight{ directLighting == MIS ? powerHeuristic(pdfLight, pdfOf(mat, ray, rec, direction)) : 1.0 };
+    shadowRay = Ray(rec.p, toLight, ray.time);
+    direct = light.emitted * (eval / pdfLight * weight);
+    return true;
+}
+
+Color Camera::directLight(const Ray &ray, const HitRec &rec, const Primitive &scene, Sampler &sampler) const {
+    Ray shadowRay;
+    Color direct;
+    if (!sampleDirectLight(ray, rec, sampler, shadowRay, direct)) return Color();
+    HitRec shadowRec;
+    shadowRec.sampler = &sampler;
+    shadowRec.shadow = true;
+    if (scene.hit(shadowRay, RAY_EPSILON, 1.0 - 0.000001, shadowRec)) return Color();
+    return volumes.empty() ? direct : direct * shadowTransmittance(shadowRay, sampler);
 }
 
-const std::vector<std::vector<Color>> &Camera::randerLoop(const std::vector<primPointer> &constPrims) {
+double Camera::shadowTransmittance(const Ray &shadowRay, Sampler &sampler) const {
+    // Shadow rays end at the light (t = 1), volumes in between attenuate instead of blocking.
+    double transmittance{ 1.0 };
+    for (const Volume *volume : volumes) {
+        if (!volume->box.hit(shadowRay, RAY_EPSILON, 1.0 - 0.000001)) continue;
+        transmittance *= volume->transmittance(shadowRay, RAY_EPSILON, 1.0 - 0.000001, sampler);
+        if (transmittance <= 0.0) break;
+    }
+    return transmittance;
+}
+
+const Film &Camera::randerLoop(const std::vector<primPointer> &constPrims) {
     initialization();
 
     std::vector<primPointer> prims{ constPrims };
-    for (auto primp : prims) primp->makeAABB();
-    BVH bvh{ prims, prims.begin(), prims.end()};
+    for (auto primp : prims) {
+        // Primitives are usually built before initialization() sets Primitive::motionBlur.
+        primp->moving = motionBlur && primp->velocity.length() > 0.0;
+        primp->makeAABB();
+    }
+    lights = directLighting != BSDF_SAMPLING ? LightList(prims) : LightList();
+    volumes.clear();
+    for (const auto &prim : prims) {
+        if (auto volume = dynamic_cast<const Volume *>(prim.get())) volumes.push_back(volume);
+    }
+    if (!lights.empty()) {
+        std::cout << "Lights: " << lights.triangles.size() << " emissive triangles, area " << lights.totalArea << std::endl;
+    }
+
+    auto buildStart{ std::chrono::steady_clock::now() };
+    bool sortedBuild{ accelerator == RECURSIVE_BVH || builder == SORTED_SAH };
+    BVH bvh;
+    LinearBVH linearBVH;
+    BVH4 bvh4;
+    BVH8 bvh8;
+    // Binned builder makes LinearBVH directly, the sorted SAH tree is only needed otherwise.
+    if (sortedBuild) bvh = BVH(prims, prims.begin(), prims.end());
     //std::cout << "BVH tree:\n" << std::endl;
     //bvh.printSelf();
+    if (accelerator != RECURSIVE_BVH) {
+        if (builder == BINNED_SAH) linearBVH = LinearBVH(prims, maxLeafSize);
+        else linearBVH = LinearBVH(bvh);
+    }
+    if (accelerator == WIDE_BVH4) bvh4 = BVH4(linearBVH);
+    if (accelerator == WIDE_BVH8) bvh8 = BVH8(linearBVH);
+    std::chrono::duration<double, std::milli> buildTime{ std::chrono::steady_clock::now() - buildStart };
+    std::cout << "BVH build (" << (sortedBuild ? "sorted" : "binned") << " SAH): "
+        << buildTime.count() << " ms" << std::endl;
+    if (accelerator != RECURSIVE_BVH) {
+        linearBVH.printSelf();
+        std::cout << "SAH cost: " << linearBVH.sahCost() << std::endl;
+    }
+    if (accelerator == WIDE_BVH4) bvh4.printSelf();
+    if (accelerator == WIDE_BVH8) bvh8.printSelf();
+
+    const Primitive *scenePointer{ &bvh };
+    if (accelerator == LINEAR_BVH) scenePointer = &linearBVH;
+    else if (accelerator == WIDE_BVH4) scenePointer = &bvh4;
+    else if (accelerator == WIDE_BVH8) scenePointer = &bvh8;
+    const Primitive &scene{ *scenePointer };
+    bool packets{ packetSize && accelerator == LINEAR_BVH };
+    if (packets && packetSize != 4 && packetSize != 8 && packetSize != 16) {
+        std::cout << "Packet size " << packetSize << " unsupported, use 4, 8 or 16." << std::endl;
+        packets = false;
+    }
+    if (packetSize && accelerator != LINEAR_BVH) std::cout << "Ray packets need LINEAR_BVH, tracing single rays." << std::endl;
+    if (packets && adaptive) {
+        std::cout << "Adaptive sampling traces single rays, packets disabled." << std::endl;
+        packets = false;
+    }
+    bool waves{ wavefront };
+    if (waves && adaptive) {
+        std::cout << "Adaptive sampling traces single rays, wavefront disabled." << std::endl;
+        waves = false;
+    }
+    if (waves && packets) {
+        std::cout << "Wavefront engine traces single rays, packets disabled." << std::endl;
+        packets = false;
+    }
+    if (adaptive) sampleCounts.assign(resHeight, std::vector<int>(resWidth, 0));
 
     // Rendering loop
-    std::cout << "\nRendering start." << std::endl;
+    // Tiles a whole number of film cache lines wide, so no two threads write to the same line.
+    int lineAlignedTileSize{ (tileSize + Film::LINE_PIXELS - 1) / Film::LINE_PIXELS * Film::LINE_PIXELS };
+    tiles = makeTiles(resWidth, resHeight, lineAlignedTileSize, tileOrder);
+    bool resized{ film.width != resWidth || film.height != resHeight };
+    if (output && (resized || !output->views(film.view()))) throw "ImageWriter output must view the film at the camera resolution.";
+    if (resized) film = Film(resWidth, resHeight);
+    else if (!accumulate) film.clear();
+    WorkStealingPool pool(threads);
+    std::cout << "\nRendering start. " << tiles.size() << " tiles, " << pool.threadCount << " threads." << std::endl;
+
+    std::atomic<int> finishedTiles{ 0 };
+    std::vector<WavefrontStats> threadStats(pool.threadCount);
+    pool.run(static_cast<int>(tiles.size()), [&](int task, int thread) {
+        Tile &tile{ tiles[task] };
+        auto tileStart{ std::chrono::steady_clock::now() };
+        if (adaptive) {
+            for (int row{ tile.y0 }; row < tile.y1; ++row) {
+                for (int col{ tile.x0 }; col < tile.x1; ++col) {
+                    Color sum{ samplePixelAdaptive(row, col, scene, sampleCounts[row][col]) };
+                    film.add(col, row, sum, sampleCounts[row][col]);
+                }
+            }
+        }
+        else if (waves) renderTileWavefront(tile, scene, threadStats[thread]);
+        else if (!packets) {
+            for (int row{ tile.y0 }; row < tile.y1; ++row) {
+                for (int col{ tile.x0 }; col < tile.x1; ++col)
+                    film.add(col, row, samplePixel(row, col, scene), antialiasing * antialiasing);
+            }
+        }
+        else if (packetSize == 4) renderTilePackets<4>(tile, linearBVH);
+        else if (packetSize == 8) renderTilePackets<8>(tile, linearBVH);
+        else renderTilePackets<16>(tile, linearBVH);
+        tile.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tileStart).count();
+        tile.thread = thread;
+        if (output) output->tileDone(tile.x0, tile.y0, tile.x1, tile.y1);
+        std::cout << "Rendering TILE " << ++finishedTiles << " of " << tiles.size()
+            << " . Thread: " << thread << std::endl;
+    });
+    std::cout << "\nRendering finished" << std::endl;
+    printTileTiming();
+    if (adaptive) printSampleCounts();
+    wavefrontStats = WavefrontStats();
+    for (const auto &stats : threadStats) wavefrontStats += stats;
+    if (waves) wavefrontStats.print();
+    TextureCacheStats cacheStats{ textureCache().stats() };
+    if (cacheStats.files) cacheStats.print();
+    return film;
+}
+
+Color Camera::samplePixel(int row, int col, const Primitive &scene) const {
+    double uStep{ 1.0 / resWidth / antialiasing };
+    double vStep{ 1.0 / resHeight / antialiasing };
+    double u{ 1.0 * col / resWidth };
+    double v{ 1.0 * row / resHeight };
+
+    Color result;
+    Sampler sampler;
+    for (int ui{ 0 }; ui < antialiasing; ++ui) {
+        for (int vi{ 0 }; vi < antialiasing; ++vi) {
+            sampler.startPixelSample(row * resWidth + col, ui * antialiasing + vi, frame, seed);
+            Ray r = getRay(u + ui * uStep, v + vi * vStep, sampler);
+            result += render(r, scene, sampler);
+        }
+    }
+    return result;
+}
+
+Color Camera::samplePixelAdaptive(int row, int col, const Primitive &scene, int &samples) const {
+    /*
+        Samples land on the antialiasing * antialiasing grid of samplePixel, strata
+        visited in a per-pixel shuffled order so an early stop still covers the pixel.
+        Once the grid is used up, further rounds jitter inside each stratum.
+        Running mean and variance of luminance (Welford), the pixel is done when
+            sqrt(variance / n) <= maxRelativeError * mean
+        Black background and flat regions converge after minSamples.
+    */
+    int strata{ antialiasing * antialiasing };
+    int budget{ maxSamples ? maxSamples : 4 * strata };
+    double uStep{ 1.0 / resWidth / antialiasing };
+    double vStep{ 1.0 / resHeight / antialiasing };
+    double u{ 1.0 * col / resWidth };
+    double v{ 1.0 * row / resHeight };
+
+    Sampler sampler;
+    std::vector<int> order(strata);
+    std::iota(order.begin(), order.end(), 0);
+    sampler.startPixelSample(row * resWidth + col, UINT32_MAX, frame, seed);
+    std::shuffle(order.begin(), order.end(), sampler);
+
+    Color result;
+    double mean{ 0.0 }, m2{ 0.0 };
+    int n{ 0 };
+    while (n < budget) {
+        int ui{ order[n % strata] / antialiasing }, vi{ order[n % strata] % antialiasing };
+        sampler.startPixelSample(row * resWidth + col, n, frame, seed);
+        double jitterU{ 0.0 }, jitterV{ 0.0 };
+        if (n >= strata) { jitterU = sampler.rand01(); jitterV = sampler.rand01(); }
+        Ray r = getRay(u + (ui + jitterU) * uStep, v + (vi + jitterV) * vStep, sampler);
+        Color c{ render(r, scene, sampler) };
+        result += c;
+
+        double y{ c.luminance() };
+        ++n;
+        double delta{ y - mean };
+        mean += delta / n;
+        m2 += delta * (y - mean);
+        if (n >= std::max(minSamples, 2) && std::sqrt(m2 / (n - 1) / n) <= maxRelativeError * mean) break;
+    }
+    samples = n;
+    return result;
+}
+
+template <int N>
+void Camera::renderTilePackets(const Tile &tile, const LinearBVH &bvh) {
+    /*
+        Camera rays of the tile are generated in the same order and with the same
+        samplers as samplePixel, so the image is identical to single ray tracing.
+        Consecutive samples of a pixel, then of its right neighbour, share a packet.
+        Only the first hit is found per packet, shading and bounces are single rays.
+    */
     double uStep{ 1.0 / resWidth / antialiasing };
     double vStep{ 1.0 / resHeight / antialiasing };
+    int tileWidth{ tile.x1 - tile.x0 };
+    std::vector<Color> sums(tileWidth * (tile.y1 - tile.y0));
 
-    //Color result;
-    omp_set_num_threads(15);
+    RayPacket<N> packet;
+    packet.tMin = RAY_EPSILON;
+    Sampler samplers[N];
+    int pixelOf[N];
+    int lanes{ 0 };
+    auto trace = [&]() {
+        int hitMask{ bvh.hitPacket(packet) };
+        for (int lane{ 0 }; lane < lanes; ++lane) {
+            const Ray &ray{ packet.rays[lane] };
+            if (hitMask >> lane & 1) sums[pixelOf[lane]] += shade(ray, packet.recs[lane], bvh, samplers[lane]);
+            else sums[pixelOf[lane]] += background(ray);
+        }
+        packet.clear();
+        lanes = 0;
+    };
 
-#pragma omp parallel for schedule(dynamic, 1) // OpenMP
-    for (int row{ 0 }; row < resHeight; ++row) {
-        std::cout << "Rendering ROW " << row + 1 << " of " << resHeight
-            << " . Thread: " << omp_get_thread_num() << std::endl;
-        for (int col{ 0 }; col < resWidth; ++col) {
+    for (int row{ tile.y0 }; row < tile.y1; ++row) {
+        for (int col{ tile.x0 }; col < tile.x1; ++col) {
             double u{ 1.0 * col / resWidth };
             double v{ 1.0 * row / resHeight };
-
-            Color result;
             for (int ui{ 0 }; ui < antialiasing; ++ui) {
                 for (int vi{ 0 }; vi < antialiasing; ++vi) {
-                    Ray r = getRay(u + ui * uStep, v + vi * vStep);
-                    result += render(r, bvh);
+                    Sampler &sampler{ samplers[lanes] };
+                    sampler.startPixelSample(row * resWidth + col, ui * antialiasing + vi, frame, seed);
+                    packet.recs[lanes] = HitRec();
+                    packet.recs[lanes].sampler = &sampler;
+                    packet.set(lanes, getRay(u + ui * uStep, v + vi * vStep, sampler), 1e10);
+                    pixelOf[lanes] = (row - tile.y0) * tileWidth + col - tile.x0;
+                    if (++lanes == N) trace();
                 }
             }
+        }
+    }
+    if (lanes) trace();
 
-            pixels[row][col] = (result / antialiasing / antialiasing).clamp();
+    for (int row{ tile.y0 }; row < tile.y1; ++row) {
+        for (int col{ tile.x0 }; col < tile.x1; ++col) {
+            film.add(col, row, sums[(row - tile.y0) * tileWidth + col - tile.x0], antialiasing * antialiasing);
         }
     }
-    std::cout << "\nRendering finished" << std::endl;
-    return pixels;
+}
+
+void Camera::printTileTiming() const {
+    if (tiles.empty()) return;
+    const Tile *slowest{ &tiles[0] }, *fastest{ &tiles[0] };
+    double total{ 0.0 };
+    std::vector<double> threadBusy;
+    for (const auto &tile : tiles) {
+        total += tile.milliseconds;
+        if (tile.milliseconds > slowest->milliseconds) slowest = &tile;
+        if (tile.milliseconds < fastest->milliseconds) fastest = &tile;
+        if (tile.thread >= static_cast<int>(threadBusy.size())) threadBusy.resize(tile.thread + 1, 0.0);
+        threadBusy[tile.thread] += tile.milliseconds;
+    }
+    double mean{ total / tiles.size() };
+    std::cout << "Tile time: min " << fastest->milliseconds << " ms, mean " << mean
+        << " ms, max " << slowest->milliseconds << " ms at (" << slowest->x0 << ", " << slowest->y0
+        << "), max / mean " << slowest->milliseconds / mean << std::endl;
+    auto busy = std::minmax_element(threadBusy.begin(), threadBusy.end());
+    std::cout << "Thread busy time: min " << *busy.first << " ms, max " << *busy.second << " ms" << std::endl;
+}
+
+void Camera::printSampleCounts() const {
+    long long total{ 0 };
+    int most{ 0 }, least{ INT32_MAX };
+    for (const auto &row : sampleCounts) {
+        for (int n : row) {
+            total += n;
+            most = std::max(most, n);
+            least = std::min(least, n);
+        }
+    }
+    double mean{ 1.0 * total / (resWidth * resHeight) };
+    std::cout << "Samples per pixel: min " << least << ", mean " << mean << ", max " << most
+        << ", fixed grid " << antialiasing * antialiasing << " (" << mean / (antialiasing * antialiasing) * 100.0
+        << "%)" << std::endl;
+}
+
+Film Camera::sampleCountHeatmap() const {
+    // Each pixel filled with its sample count, relative to the most sampled pixel.
+    Film heatmap(resWidth, resHeight);
+    int most{ 0 };
+    for (const auto &row : sampleCounts) for (int n : row) most = std::max(most, n);
+    if (!most) return heatmap;
+    for (int row{ 0 }; row < static_cast<int>(sampleCounts.size()); ++row) {
+        for (int col{ 0 }; col < static_cast<int>(sampleCounts[row].size()); ++col)
+            heatmap.set(col, row, Color(1.0 * sampleCounts[row][col] / most));
+    }
+    return heatmap;
+}
+
+Film Camera::tileTimeHeatmap() const {
+    // Each tile filled with its render time, relative to the slowest tile.
+    Film heatmap(resWidth, resHeight);
+    double slowest{ 0.0 };
+    for (const auto &tile : tiles) slowest = std::max(slowest, tile.milliseconds);
+    if (slowest <= 0.0) return heatmap;
+    for (const auto &tile : tiles) {
+        Color c(tile.milliseconds / slowest);
+        for (int row{ tile.y0 }; row < tile.y1; ++row) {
+            for (int col{ tile.x0 }; col < tile.x1; ++col) heatmap.set(col, row, c);
+        }
+    }
+    return heatmap;
 }
\ No newline at end of file
@@ -2,8 +2,22 @@
 
 #include "Ray.h"
 #include "Primitive.h"
+#include "LinearBVH.h"
+#include "WideBVH.h"
+#include "RayPacket.h"
+#include "Light.h"
+#include "Wavefront.h"
+#include "Scheduler.h"
+#include "Film.h"
+
+struct ImageWriter;
 
 enum PRESET { P1K, P2K, P4K };
+// Which acceleration structure Camera traces against. Kept switchable for A/B comparison.
+enum ACCELERATOR { RECURSIVE_BVH, LINEAR_BVH, WIDE_BVH4, WIDE_BVH8 };
+// How emissive triangles are found from non-specular vertices: by scattered rays only, by
+// sampling the light list only, or both combined with the power heuristic.
+enum DIRECT_LIGHTING { BSDF_SAMPLING, LIGHT_SAMPLING, MIS };
 
 struct Resolution {
     int width, height;
@@ -32,12 +46,45 @@ struct Camera {
     // Render
     int antialiasing{ 1 };
     int maxDepth{ 0 };
+    int rouletteDepth{ 3 };  // Russian roulette from this bounce on, 0: off
+    DIRECT_LIGHTING directLighting{ MIS };
+    uint64_t seed{ 0 };  // same seed, same image
+    uint32_t frame{ 0 };
+    // Adaptive sampling: a pixel stops once the standard error of its mean luminance drops below
+    // maxRelativeError * mean, after at least minSamples. Noisy pixels may go on up to maxSamples.
+    bool adaptive{ false };
+    int minSamples{ 16 };
+    int maxSamples{ 0 };  // 0: 4 * antialiasing * antialiasing
+    double maxRelativeError{ 0.02 };
+    std::vector<std::vector<int>> sampleCounts;  // samples spent per pixel, filled by randerLoop
+
+    // Scheduling
+    int threads{ 0 };  // 0: std::thread::hardware_concurrency()
+    int tileSize{ 16 };  // rounded up to whole cache lines of the film
+    TILE_ORDER tileOrder{ MORTON };
+    std::vector<Tile> tiles;  // with per-tile render time after randerLoop
+    ACCELERATOR accelerator{ LINEAR_BVH };
+    BVH_BUILDER builder{ BINNED_SAH };
+    int maxLeafSize{ 4 };  // binned SAH only, leaves may hold up to this many primitives
+    // 4, 8 or 16: primary rays are traced in packets of this size, bounces stay single rays.
+    // LINEAR_BVH only. 0: every ray traced alone.
+    int packetSize{ 0 };
+    // Queue based engine (Wavefront.h): paths of a tile advance together, wavefrontSize at a time,
+    // stage by stage. Same image as the default engine. Timing per stage in wavefrontStats.
+    bool wavefront{ false };
+    int wavefrontSize{ 1 << 14 };
+    WavefrontStats wavefrontStats;
 
     // Motion blur
     bool motionBlur{ false };
     double FPS{ 30.0 };
     double timeStart{ 0.0 }, timeEnd{ 1.0 / FPS }, timeIntervel{ 0.0 };
 
+    // Output
+    // If set, gets every finished tile and writes the image meanwhile. It must view film at
+    // resWidth * resHeight: randerLoop never replaces a film that is being written.
+    ImageWriter *output{ nullptr };
+
     // BG
     bool NO_BG{ false };
     Color BGUp{ 0xBBBBFF }, BGDown{ 0xffac9b };
@@ -45,17 +92,22 @@ struct Camera {
     double dim{ 1.0 };
 
 
-    std::vector<std::vector<Color>> pixels;
+    Film film;  // radiance, 8-bit output clamps it
+    // randerLoop adds its samples to the film instead of starting over. With a new frame
+    // number each call, the image converges progressively.
+    bool accumulate{ false };
 
     Camera() = default;
     Camera(int w, int h, double zoom = 1.0) : resWidth(w * zoom), resHeight(h * zoom),
-        pixels(resHeight, std::vector<Color>(resWidth)) {}
+        film(resWidth, resHeight) {}
     Camera(PRESET prst, double zoom = 1.0) :
         resWidth(static_cast<int>(presets[prst].width * zoom)),
         resHeight(static_cast<int>(presets[prst].height * zoom)),
-        pixels(resHeight, std::vector<Color>(resWidth)) {}
+        film(resWidth, resHeight) {}
 
-    const std::vector<std::vector<Color>> &randerLoop(const std::vector<primPointer> &constPrims);
+    const Film &randerLoop(const std::vector<primPointer> &constPrims);
+    Film tileTimeHeatmap() const;
+    Film sampleCountHeatmap() const;
 
 private:
     double filmWidth{ 1.0 };
@@ -63,10 +115,30 @@ private:
     double distanceToFocus{ 0.0 };
     double lensRadius{ 0.0 };
     Vec3 leftDownCorner, right, up;
+    LightList lights;
+    std::vector<const Volume *> volumes;  // shadow rays pass through these, attenuated
     void initialization();
-    Vec3 sampleInCircle();
-    Color render(const Ray &ray, const BVH &bvh, int depth = 0) const;
-    Ray getRay(double u, double v);
+    Vec3 sampleInCircle(Sampler &sampler) const;
+    Color render(const Ray &ray, const Primitive &scene, Sampler &sampler) const;
+    Color shade(const Ray &cameraRay, const HitRec &firstHit, const Primitive &scene, Sampler &sampler) const;
+    Color directLight(const Ray &ray, const HitRec &rec, const Primitive &scene, Sampler &sampler) const;
+    double shadowTransmittance(const Ray &shadowRay, Sampler &sampler) const;
+    bool sampleDirectLight(const Ray &ray, const HitRec &rec, Sampler &sampler, Ray &shadowRay, Color &direct) const;
+    double lightPdf(const Ray &ray, const HitRec &lightRec) const;
+    double emissionWeight(const Ray &ray, const HitRec &lightRec, bool lightSampled, double scatterPDF) const;
+    static double powerHeuristic(double pdfA, double pdfB);
+    Ray getRay(double u, double v, Sampler &sampler) const;
+    // Both return the sum of the samples taken.
+    Color samplePixel(int row, int col, const Primitive &scene) const;
+    Color samplePixelAdaptive(int row, int col, const Primitive &scene, int &samples) const;
+    template <int N>
+    void renderTilePackets(const Tile &tile, const LinearBVH &bvh);
+    void renderTileWavefront(const Tile &tile, const Primitive &scene, WavefrontStats &stats);
+    template <typename MaterialType>
+    void shadePass(const std::vector<int> &queue, PathStates &paths, ShadowQueue &shadows,
+        std::vector<int> &next, int depth) const;
+    void printTileTiming() const;
+    void printSampleCounts() const;
     Color background(const Ray &ray) const {
         if (NO_BG) return Color();
         double c{ (ray.direction.normalized() * up * up).y };
@@ -2,50 +2,56 @@
 #include <iostream>
 #include "Vector.h"
 
-struct Color {
-    double R{ 0.0 }, G{ 0.0 }, B{ 0.0 };
-    static constexpr double gammaCorrection{ 1.0 / 2.2 };
+template <typename T>
+struct ColorT {
+    T R{ 0.0 }, G{ 0.0 }, B{ 0.0 };
+    static constexpr T gammaCorrection{ T(1) / T(2.2) };
 
-    Color() = default;
-    Color(int c) : R((c >> 16) / 255.99), G(((c & 0x00FF00) >> 8) / 255.99), B((c & 0x0000FF) / 255.99) {}
-    Color(double r, double g, double b) : R(r), G(g), B(b) {}
-    Color(const Vec3 &vec) : R(vec.x), G(vec.y), B(vec.z) {}
-    Color(double g) :R(g), G(g), B(g) {}  // gray
-    Color operator+(const Color &c) const { return Color(R + c.R, G + c.G, B + c.B); }
-    Color operator-(const Color &c) const { return Color(R - c.R, G - c.G, B - c.B); }
-    Color operator*(const Color &c) const { return Color(R * c.R, G * c.G, B * c.B); }
-    Color operator/(const Color &c) const { return Color(R / c.R, G / c.G, B / c.B); }
-    Color operator*(const double &n) const { return Color(R * n, G * n, B * n); }
-    Color operator/(const double &n) const { return Color(R / n, G / n, B / n); }
-    Color &operator+=(const Color &c) { R += c.R; G += c.G; B += c.B; return *this; }
-    Color &operator-=(const Color &c) { R -= c.R; G -= c.G; B -= c.B; return *this; }
-    Color &operator*=(const Color &c) { R *= c.R; G *= c.G; B *= c.B; return *this; }
-    Color &operator/=(const Color &c) { R /= c.R; G /= c.G; B /= c.B; return *this; }
-    Color &operator*=(const double &n) { R *= n; G *= n; B *= n; return *this; }
-    Color &operator/=(const double &n) { R /= n; G /= n; B /= n; return *this; }
+    ColorT() = default;
+    ColorT(int c) : R((c >> 16) / T(255.99)), G(((c & 0x00FF00) >> 8) / T(255.99)), B((c & 0x0000FF) / T(255.99)) {}
+    ColorT(T r, T g, T b) : R(r), G(g), B(b) {}
+    template <typename U>
+    ColorT(const Vec3T<U> &vec) : R(vec.x), G(vec.y), B(vec.z) {}
+    ColorT(T g) :R(g), G(g), B(g) {}  // gray
+    ColorT operator+(const ColorT &c) const { return ColorT(R + c.R, G + c.G, B + c.B); }
+    ColorT operator-(const ColorT &c) const { return ColorT(R - c.R, G - c.G, B - c.B); }
+    ColorT operator*(const ColorT &c) const { return ColorT(R * c.R, G * c.G, B * c.B); }
+    ColorT operator/(const ColorT &c) const { return ColorT(R / c.R, G / c.G, B / c.B); }
+    ColorT operator*(const T &n) const { return ColorT(R * n, G * n, B * n); }
+    ColorT operator/(const T &n) const { return ColorT(R / n, G / n, B / n); }
+    ColorT &operator+=(const ColorT &c) { R += c.R; G += c.G; B += c.B; return *this; }
+    ColorT &operator-=(const ColorT &c) { R -= c.R; G -= c.G; B -= c.B; return *this; }
+    ColorT &operator*=(const ColorT &c) { R *= c.R; G *= c.G; B *= c.B; return *this; }
+    ColorT &operator/=(const ColorT &c) { R /= c.R; G /= c.G; B /= c.B; return *this; }
+    ColorT &operator*=(const T &n) { R *= n; G *= n; B *= n; return *this; }
+    ColorT &operator/=(const T &n) { R /= n; G /= n; B /= n; return *this; }
 
-    Color &operator=(const Vec3 &vec) { R = vec.x; G = vec.y; B = vec.z; return *this; }
+    template <typename U>
+    ColorT &operator=(const Vec3T<U> &vec) { R = vec.x; G = vec.y; B = vec.z; return *this; }
 
     // Gamma encoding to sRGB
-    //int d2i(const double &channel) const {
+    //int d2i(const T &channel) const {
     //    return static_cast<int>(255.99 * std::pow(channel, gammaCorrection));
     //}
-    int d2i(const double &channel) const { return static_cast<int>(255.99 * channel); }
-    char d2c(const double &channel) const { return static_cast<char>(d2i(channel)); }
-    Color &clamp();
+    int d2i(const T &channel) const { return static_cast<int>(T(255.99) * channel); }
+    char d2c(const T &channel) const { return static_cast<char>(d2i(channel)); }
+    ColorT &clamp();
+    T luminance() const { return T(0.2126) * R + T(0.7152) * G + T(0.0722) * B; }  // Rec. 709 weights
 
-    friend std::ostream &operator<<(std::ostream &os, const Color &c);
-    friend Color operator*(const double &n, const Color &c) { return c * n; }
+    friend std::ostream &operator<<(std::ostream &os, const ColorT &c) {
+        os << c.d2i(c.R) << ' ' << c.d2i(c.G) << ' ' << c.d2i(c.B) << '\n';
+        return os;
+    }
+    friend ColorT operator*(const T &n, const ColorT &c) { return c * n; }
 };
 
-inline Color &Color::clamp() {
-    R = R <= 1.0 ? R : 1.0;
-    G = G <= 1.0 ? G : 1.0;
-    B = B <= 1.0 ? B : 1.0;
+template <typename T>
+inline ColorT<T> &ColorT<T>::clamp() {
+    R = R <= T(1) ? R : T(1);
+    G = G <= T(1) ? G : T(1);
+    B = B <= T(1) ? B : T(1);
     return *this;
 }
 
-inline std::ostream &operator<<(std::ostream &os, const Color &c) {
-    os << c.d2i(c.R) << ' ' << c.d2i(c.G) << ' ' << c.d2i(c.B) << std::endl;
-    return os;
-}
+// Radiance stays in double whatever Real is: accumulating thousands of samples per pixel needs it.
+using Color = ColorT<double>;
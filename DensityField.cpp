@@ -0,0 +1,77 @@
+#include "DensityField.h"
+
+double TextureDensity::maxDensity(const AABB &region) const {
+    if (!estimateMajorant) return scale * bound;
+    Vec3 size{ region.maxBound - region.minBound };
+    double largest{ 0.0 };
+    for (int z{ 0 }; z < SAMPLES; ++z) {
+        for (int y{ 0 }; y < SAMPLES; ++y) {
+            for (int x{ 0 }; x < SAMPLES; ++x) {
+                Vec3 p{ region.minBound + Vec3(size.x * x, size.y * y, size.z * z) / (SAMPLES - 1.0) };
+                largest = std::max(largest, density(p));
+            }
+        }
+    }
+    return std::min(scale * bound, largest + margin * scale * bound);
+}
+
+GridDensity::GridDensity(int x, int y, int z, const std::vector<float> &v, const AABB &b) :
+    nx(x), ny(y), nz(z), values(v), bounds(b) {
+    if (x <= 0 || y <= 0 || z <= 0 || v.size() != static_cast<size_t>(x) * y * z) throw "Density grid does not match its size.";
+}
+
+double GridDensity::density(const Vec3 &p) const {
+    // Voxel centers sit at (i + 0.5) / n of the bounds, points beyond the outer centers take the edge voxels.
+    Vec3 size{ bounds.maxBound - bounds.minBound };
+    double gx{ (p.x - bounds.minBound.x) / size.x * nx - 0.5 };
+    double gy{ (p.y - bounds.minBound.y) / size.y * ny - 0.5 };
+    double gz{ (p.z - bounds.minBound.z) / size.z * nz - 0.5 };
+    double fx{ std::floor(gx) }, fy{ std::floor(gy) }, fz{ std::floor(gz) };
+    double tx{ gx - fx }, ty{ gy - fy }, tz{ gz - fz };
+    auto clampIndex = [](double i, int n) { return static_cast<int>(std::max(std::min(i, n - 1.0), 0.0)); };
+    int x0{ clampIndex(fx, nx) }, x1{ clampIndex(fx + 1.0, nx) };
+    int y0{ clampIndex(fy, ny) }, y1{ clampIndex(fy + 1.0, ny) };
+    int z0{ clampIndex(fz, nz) }, z1{ clampIndex(fz + 1.0, nz) };
+
+    auto lerp = [](double a, double b, double t) { return a + (b - a) * t; };
+    double front{ lerp(lerp(voxel(x0, y0, z0), voxel(x1, y0, z0), tx), lerp(voxel(x0, y1, z0), voxel(x1, y1, z0), tx), ty) };
+    double back{ lerp(lerp(voxel(x0, y0, z1), voxel(x1, y0, z1), tx), lerp(voxel(x0, y1, z1), voxel(x1, y1, z1), tx), ty) };
+    return std::max(0.0, lerp(front, back, tz));
+}
+
+double GridDensity::maxDensity(const AABB &region) const {
+    // Trilinear values never exceed the voxels they blend, so the largest voxel in reach is exact.
+    Vec3 size{ bounds.maxBound - bounds.minBound };
+    auto first = [&](double p, double lo, double extent, int n) {
+        return std::max(static_cast<int>(std::floor((p - lo) / extent * n - 0.5)), 0);
+    };
+    auto last = [&](double p, double lo, double extent, int n) {
+        return std::min(static_cast<int>(std::floor((p - lo) / extent * n - 0.5)) + 1, n - 1);
+    };
+    int x0{ std::min(first(region.minBound.x, bounds.minBound.x, size.x, nx), nx - 1) };
+    int y0{ std::min(first(region.minBound.y, bounds.minBound.y, size.y, ny), ny - 1) };
+    int z0{ std::min(first(region.minBound.z, bounds.minBound.z, size.z, nz), nz - 1) };
+    int x1{ std::max(last(region.maxBound.x, bounds.minBound.x, size.x, nx), x0) };
+    int y1{ std::max(last(region.maxBound.y, bounds.minBound.y, size.y, ny), y0) };
+    int z1{ std::max(last(region.maxBound.z, bounds.minBound.z, size.z, nz), z0) };
+
+    double largest{ 0.0 };
+    for (int z{ z0 }; z <= z1; ++z)
+        for (int y{ y0 }; y <= y1; ++y)
+            for (int x{ x0 }; x <= x1; ++x) largest = std::max(largest, voxel(x, y, z));
+    return largest;
+}
+
+MajorantGrid::MajorantGrid(const DensityField &field, const AABB &b, int res) :
+    resolution{ res, res, res }, bounds(b), majorants(static_cast<size_t>(res) * res * res) {
+    Vec3 cellSize{ (bounds.maxBound - bounds.minBound) / res };
+    for (int z{ 0 }; z < res; ++z) {
+        for (int y{ 0 }; y < res; ++y) {
+            for (int x{ 0 }; x < res; ++x) {
+                Vec3 cellMin{ bounds.minBound + Vec3(cellSize.x * x, cellSize.y * y, cellSize.z * z) };
+                AABB cell(cellMin, cellMin + cellSize, 0.0);
+                majorants[(static_cast<size_t>(z) * res + y) * res + x] = field.maxDensity(cell);
+            }
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "AABB.h"
+#include "Texture.h"
+
+struct DensityField {
+    // Extinction per unit length of a heterogeneous Volume, in the volume's local space.
+    virtual double density(const Vec3 &p) const = 0;
+    // Upper bound of density over region, used as majorant. Delta tracking is biased where it is too low.
+    virtual double maxDensity(const AABB &region) const = 0;
+    virtual ~DensityField() = default;
+};
+
+struct TextureDensity : public DensityField {
+    /*
+        Procedural density: scale * the red channel of a texture, e.g. PerlinNoise.
+        bound is the largest value the texture can return, so scale * bound is a true
+        majorant everywhere and maxDensity returns it by default.
+        With estimateMajorant, maxDensity takes the largest of SAMPLES^3 values spread
+        over the region plus margin * scale * bound instead. Tighter, so faster, but
+        tracking is biased wherever the texture peaks above it between samples.
+    */
+    static constexpr int SAMPLES{ 5 };
+    std::shared_ptr<Texture> texture;
+    double scale{ 1.0 };
+    double bound{ 1.0 };
+    bool estimateMajorant{ false };
+    double margin{ 0.1 };
+
+    TextureDensity() = default;
+    template <typename TextureType>
+    TextureDensity(const TextureType &t, double s = 1.0, double b = 1.0) :
+        texture(std::make_shared<TextureType>(t)), scale(s), bound(b) { classifyTexture(*texture); }
+    virtual double density(const Vec3 &p) const override {
+        return std::max(0.0, scale * textureValue(*texture, Vec2(), p).R);
+    }
+    virtual double maxDensity(const AABB &region) const override;
+};
+
+struct GridDensity : public DensityField {
+    // Voxel densities over bounds, x fastest, trilinear between voxel centers.
+    int nx{ 0 }, ny{ 0 }, nz{ 0 };
+    std::vector<float> values;
+    AABB bounds;
+
+    GridDensity() = default;
+    GridDensity(int x, int y, int z, const std::vector<float> &v, const AABB &b);
+    virtual double density(const Vec3 &p) const override;
+    virtual double maxDensity(const AABB &region) const override;
+
+private:
+    double voxel(int x, int y, int z) const { return values[(static_cast<size_t>(z) * ny + y) * nx + x]; }
+};
+
+struct MajorantGrid {
+    /*
+        Coarse grid over a volume's local box, every cell holding the largest density in it.
+        traverse walks the cells a ray crosses front to back (3D DDA), so trackers sample
+        against a tight local bound and skip empty cells without evaluating density.
+    */
+    int resolution[3]{ 0, 0, 0 };
+    AABB bounds;
+    std::vector<double> majorants;
+
+    MajorantGrid() = default;
+    MajorantGrid(const DensityField &field, const AABB &b, int res = 16);
+
+    // visit(cellT0, cellT1, majorant) for every cell between t0 and t1, stops when visit returns false.
+    template <typename Visit>
+    void traverse(const Ray &ray, double t0, double t1, Visit &&visit) const;
+};
+
+template <typename Visit>
+void MajorantGrid::traverse(const Ray &ray, double t0, double t1, Visit &&visit) const {
+    if (t0 >= t1) return;
+    Vec3 start{ ray.pointAtT(t0) };
+    const double origin[3]{ ray.origin.x, ray.origin.y, ray.origin.z };
+    const double direction[3]{ ray.direction.x, ray.direction.y, ray.direction.z };
+    const double position[3]{ start.x, start.y, start.z };
+    const double minBound[3]{ bounds.minBound.x, bounds.minBound.y, bounds.minBound.z };
+    const double maxBound[3]{ bounds.maxBound.x, bounds.maxBound.y, bounds.maxBound.z };
+
+    int cell[3], step[3];
+    double tNext[3], tDelta[3];
+    for (int axis{ 0 }; axis < 3; ++axis) {
+        double cellSize{ (maxBound[axis] - minBound[axis]) / resolution[axis] };
+        cell[axis] = std::min(std::max(static_cast<int>((position[axis] - minBound[axis]) / cellSize), 0), resolution[axis] - 1);
+        if (direction[axis] > 0.0) {
+            step[axis] = 1;
+            tNext[axis] = (minBound[axis] + (cell[axis] + 1) * cellSize - origin[axis]) / direction[axis];
+            tDelta[axis] = cellSize / direction[axis];
+        } else if (direction[axis] < 0.0) {
+            step[axis] = -1;
+            tNext[axis] = (minBound[axis] + cell[axis] * cellSize - origin[axis]) / direction[axis];
+            tDelta[axis] = -cellSize / direction[axis];
+        } else {
+            step[axis] = 0;
+            tNext[axis] = INFINITY;
+            tDelta[axis] = INFINITY;
+        }
+    }
+
+    double t{ t0 };
+    for (;;) {
+        int axis{ tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2) };
+        double cellEnd{ std::min(std::max(tNext[axis], t), t1) };
+        double majorant{ majorants[(static_cast<size_t>(cell[2]) * resolution[1] + cell[1]) * resolution[0] + cell[0]] };
+        if (!visit(t, cellEnd, majorant) || cellEnd >= t1) return;
+        t = cellEnd;
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= resolution[axis]) return;
+        tNext[axis] += tDelta[axis];
+    }
+}
@@ -0,0 +1,29 @@
+#include "Film.h"
+#include <cstdint>
+#include <algorithm>
+
+static_assert(sizeof(FilmPixel) == 4 * sizeof(double), "ImageView reads FilmPixel as 4 doubles.");
+
+Film::Film(int w, int h) : width(w), height(h) {
+    stride = (static_cast<size_t>(w) + LINE_PIXELS - 1) / LINE_PIXELS * LINE_PIXELS;
+    // std::vector only aligns to FilmPixel, one line more leaves room to start on a cache line.
+    buffer.resize(stride * h + LINE_PIXELS);
+    size_t misalignment{ reinterpret_cast<uintptr_t>(buffer.data()) % 64 };
+    offset = misalignment ? (64 - misalignment) / sizeof(FilmPixel) : 0;
+}
+
+void Film::clear() {
+    std::fill(buffer.begin(), buffer.end(), FilmPixel());
+}
+
+ImageView Film::view() const {
+    ImageView image;
+    if (buffer.empty()) return image;
+    image.base = &buffer[offset].sum.R;
+    image.width = width;
+    image.height = height;
+    image.pixelStride = 4;
+    image.rowStride = static_cast<ptrdiff_t>(stride) * 4;
+    image.weightOffset = 3;
+    return image;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Color.h"
+
+struct ImageView {
+    /*
+        Read-only view of RGB pixels in any layout, so encoders take an image without copying it.
+        Pixel (x, y) starts at base + y * rowStride + x * pixelStride doubles with R, G, B.
+        With weightOffset >= 0 the double that far into the pixel is the sample weight its
+        channels are divided by, pixels without weight being black.
+    */
+    const double *base{ nullptr };
+    int width{ 0 }, height{ 0 };
+    ptrdiff_t rowStride{ 0 }, pixelStride{ 3 };
+    int weightOffset{ -1 };
+
+    Color operator()(int x, int y) const {
+        const double *p{ base + y * rowStride + x * pixelStride };
+        Color c(p[0], p[1], p[2]);
+        if (weightOffset < 0) return c;
+        return p[weightOffset] > 0.0 ? c / p[weightOffset] : Color();
+    }
+};
+
+struct alignas(32) FilmPixel {
+    Color sum;  // of radiance * weight
+    double weight{ 0.0 };
+};
+
+struct Film {
+    /*
+        Radiance sum and weight of every pixel, in one contiguous buffer. Samples are only
+        ever added, so rendering more of them into a film refines it. Every row starts on
+        a cache line of LINE_PIXELS pixels: threads filling tiles whose left edges are
+        multiples of LINE_PIXELS never write to the same line.
+    */
+    static constexpr int LINE_PIXELS{ 64 / static_cast<int>(sizeof(FilmPixel)) };
+    int width{ 0 }, height{ 0 };
+    size_t stride{ 0 };  // pixels from one row to the next, padding included
+
+    Film() = default;
+    Film(int w, int h);
+
+    FilmPixel &at(int x, int y) { return buffer[offset + y * stride + x]; }
+    const FilmPixel &at(int x, int y) const { return buffer[offset + y * stride + x]; }
+    // One sample of weight 1.
+    void add(int x, int y, const Color &radiance) {
+        FilmPixel &p{ at(x, y) };
+        p.sum += radiance;
+        p.weight += 1.0;
+    }
+    // Samples already summed up, weight being their total weight.
+    void add(int x, int y, const Color &sum, double weight) {
+        FilmPixel &p{ at(x, y) };
+        p.sum += sum;
+        p.weight += weight;
+    }
+    void set(int x, int y, const Color &c) { at(x, y) = FilmPixel{ c, 1.0 }; }
+    Color value(int x, int y) const {
+        const FilmPixel &p{ at(x, y) };
+        return p.weight > 0.0 ? p.sum / p.weight : Color();
+    }
+    void clear();
+    ImageView view() const;
+
+private:
+    std::vector<FilmPixel> buffer;
+    size_t offset{ 0 };  // pixels before the first cache line boundary
+};
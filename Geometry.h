@@ -1,6 +1,10 @@
 #pragma once
 
+#include <type_traits>
 #include "Primitive.h"
+#include "TriangleMesh.h"
+#include "Instance.h"
+#include "meshIO.h"
 #include "Transformation.h"
 
 struct Geometry {
@@ -34,8 +38,10 @@ struct Square : public Geometry {
         Vec3 C { Vec3(-xLen * 0.5, 0.0, -zLen * 0.5)};
         Vec3 D { Vec3(-xLen * 0.5, 0.0,  zLen * 0.5)};
         Vec2 uvA(1.0, 0.0), uvB(1.0, 1.0), uvC(0.0, 1.0), uvD(0.0, 0.0);
-        prims.push_back(std::make_shared<Triangle>(Triangle(A, B, D, uvA, uvB, uvD, mat)));
-        prims.push_back(std::make_shared<Triangle>(Triangle(B, C, D, uvB, uvC, uvD, mat)));
+        // Both triangles share one material table entry.
+        uint32_t matId{ MaterialTable::add(mat) };
+        prims.push_back(std::make_shared<Triangle>(Triangle(A, B, D, uvA, uvB, uvD, matId)));
+        prims.push_back(std::make_shared<Triangle>(Triangle(B, C, D, uvB, uvC, uvD, matId)));
     }
 };
 
@@ -47,13 +53,14 @@ struct Cuboid : public Geometry {
     Cuboid(const MaterialType &mat, double xl, double h = 0., double zl = 0.) :
         xLen(xl), zLen(zl ? zl : xl), height(h ? h : xl) {
         using TF = Transformation;
+        uint32_t matId{ MaterialTable::add(mat) };
         Geometry container = Geometry() +
-            Square(mat, xLen, zLen) * TF(TF::RX, 180) +                                                 // bottom
-            Square(mat, xLen, zLen) * TF(TF::T, 0, height, 0) +                                         // up
-            Square(mat, xLen, height) * TF(TF::RX,  90) * TF(TF::T, 0, height * 0.5, zLen *  0.5) +     // front
-            Square(mat, xLen, height) * TF(TF::RX, -90) * TF(TF::T, 0, height * 0.5, zLen * -0.5) +     // back
-            Square(mat, height, zLen) * TF(TF::RZ,  90) * TF(TF::T, xLen * -0.5, height * 0.5, 0) +     // left
-            Square(mat, height, zLen) * TF(TF::RZ, -90) * TF(TF::T, xLen *  0.5, height * 0.5, 0);      // right
+            Square(matId, xLen, zLen) * TF(TF::RX, 180) +                                                 // bottom
+            Square(matId, xLen, zLen) * TF(TF::T, 0, height, 0) +                                         // up
+            Square(matId, xLen, height) * TF(TF::RX,  90) * TF(TF::T, 0, height * 0.5, zLen *  0.5) +     // front
+            Square(matId, xLen, height) * TF(TF::RX, -90) * TF(TF::T, 0, height * 0.5, zLen * -0.5) +     // back
+            Square(matId, height, zLen) * TF(TF::RZ,  90) * TF(TF::T, xLen * -0.5, height * 0.5, 0) +     // left
+            Square(matId, height, zLen) * TF(TF::RZ, -90) * TF(TF::T, xLen *  0.5, height * 0.5, 0);      // right
         prims = container.prims;
     }
 };
@@ -107,4 +114,29 @@ struct VolumeGeo : public Geometry {
     VolumeGeo(double x, double z, double y, double d = 1.0, const TextureType &t = ConstantTexture(WHITE)) {
         prims.push_back(std::make_shared<Volume>(Volume(x, z, y, d, t)));
     }
+    // Heterogeneous density, e.g. TextureDensity(PerlinNoise(...), 2.0) or a GridDensity.
+    template <typename DensityType, typename TextureType = ConstantTexture,
+        typename = std::enable_if_t<std::is_base_of_v<DensityField, DensityType>>>
+    VolumeGeo(double x, double z, double y, const DensityType &field, const TextureType &t = ConstantTexture(WHITE)) {
+        prims.push_back(std::make_shared<Volume>(Volume(x, z, y, std::make_shared<DensityType>(field), t)));
+    }
+};
+
+struct InstanceGeo : public Geometry {
+    // One Instance of a shared Prototype, placed with * Transformation like any other Geometry, e.g.
+    //     auto box{ std::make_shared<Prototype>(Cuboid(Lambertian(WHITE), 1.0).prims) };
+    //     geos = geos + InstanceGeo(box) * TF(TF::T, x, 0, z);
+    InstanceGeo() = default;
+    InstanceGeo(const prototypePointer &prototype) { prims.push_back(std::make_shared<Instance>(prototype)); }
+};
+
+struct MeshGeo : public Geometry {
+    // One TriangleMesh primitive loaded from an OBJ or binary PLY file.
+    MeshGeo() = default;
+    template <typename MaterialType>
+    MeshGeo(const std::string &filename, const MaterialType &mat) {
+        auto mesh = std::make_shared<TriangleMesh>(mat);
+        inputMesh(filename, *mesh);
+        prims.push_back(mesh);
+    }
 };
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "Instance.h"
+
+Prototype::Prototype(const std::vector<primPointer> &ps, int maxLeafSize) : prims(ps) {
+    for (const auto &prim : prims) {
+        if (dynamic_cast<const Volume *>(prim.get())) throw "Volumes cannot be instanced.";
+        prim->makeAABB();
+    }
+    bvh = LinearBVH(prims, maxLeafSize);
+}
+
+bool Instance::hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const {
+    // Affine maps keep the ray parameter, so tMin, tMax and rec.t need no conversion.
+    Ray localRay(ray.origin * tfi, ray.direction * rot, ray.time);
+    if (!prototype->bvh.hit(localRay, tMin, tMax, rec)) return false;
+    rec.p = ray.pointAtT(rec.t);
+    rec.normal = (rec.normal * normalTf).normalized();
+    rec.geometricNormal = (rec.geometricNormal * normalTf).normalized();
+    return true;
+}
+
+void Instance::printSelf() const {
+    std::cout << "Instance of " << prototype->prims.size() << " primitives";
+}
+
+void Instance::transform(const Transformation &trans) {
+    tf = tf * trans;
+    tfi = tf.inverted();
+    rot = tfi;
+    rot[3] = 0.0;
+    rot[7] = 0.0;
+    rot[11] = 0.0;
+    // Normals go through the inverse transpose, translation dropped.
+    normalTf = tfi.transposed();
+    normalTf[3] = 0.0;
+    normalTf[7] = 0.0;
+    normalTf[11] = 0.0;
+}
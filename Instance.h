@@ -0,0 +1,40 @@
+#pragma once
+
+#include "LinearBVH.h"
+
+struct Prototype {
+    /*
+        Object-space primitives and their BVH, built once and shared by every Instance
+        placed from it. N copies of an asset cost one set of primitives and one BVH plus
+        N Instance records, the scene BVH over the instances being the top level.
+        Volumes cannot be part of one: shadow rays find them in Camera's volume list.
+    */
+    std::vector<primPointer> prims;
+    LinearBVH bvh;
+
+    Prototype() = default;
+    Prototype(const std::vector<primPointer> &ps, int maxLeafSize = 4);
+    const AABB &box() const { return bvh.box; }
+};
+
+using prototypePointer = std::shared_ptr<const Prototype>;
+
+struct Instance : public Primitive {
+    // One placement of a Prototype. Rays go to object space through the cached inverse,
+    // hits come back to world space. Materials are the ones of the prototype's primitives.
+    prototypePointer prototype;
+    Transformation tf, tfi, rot, normalTf;  // object to world, world to object, its linear part, normals to world
+
+    Instance() = default;
+    Instance(const prototypePointer &p) : prototype(p) {}
+
+    bool hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const override;
+    void makeAABB() override {
+        box = prototype->box() * tf;
+        centroid = box.center;
+    }
+    virtual void printSelf() const override;
+    virtual Vec2 uv(const Vec3 &p) const override { return Vec2(); }
+    // Applied after the transformations already set, like transform() on real primitives.
+    virtual void transform(const Transformation &trans) override;
+};
@@ -0,0 +1,79 @@
+#include "Light.h"
+#include <algorithm>
+
+LightList::LightList(const std::vector<primPointer> &prims) {
+    for (const auto &prim : prims) addPrimitive(*prim, nullptr);
+}
+
+void LightList::addPrimitive(const Primitive &prim, const Transformation *trans) {
+    if (auto instance = dynamic_cast<const Instance *>(&prim)) {
+        Transformation placed{ trans ? instance->tf * *trans : instance->tf };
+        for (const auto &inner : instance->prototype->prims) addPrimitive(*inner, &placed);
+        return;
+    }
+    if (!MaterialTable::get(prim.matId).LIGHT) return;
+    auto place = [trans](const Vec3 &p) { return trans ? p * *trans : p; };
+    // A mirroring placement reverses the winding, while Instance::hit maps normals through the
+    // inverse transpose and keeps them on their side. Swapping B and C keeps the light facing that way.
+    bool mirrored{ trans && trans->determinant() < 0.0 };
+    auto addPlaced = [&](const Vec3 &a, const Vec3 &b, const Vec3 &c, const Vec2 &uva, const Vec2 &uvb, const Vec2 &uvc, uint32_t matId) {
+        if (mirrored) add(place(a), place(c), place(b), uva, uvc, uvb, matId);
+        else add(place(a), place(b), place(c), uva, uvb, uvc, matId);
+    };
+    if (auto triangle = dynamic_cast<const Triangle *>(&prim)) {
+        addPlaced(triangle->A, triangle->B, triangle->C, triangle->uvA, triangle->uvB, triangle->uvC, triangle->matId);
+    } else if (auto mesh = dynamic_cast<const TriangleMesh *>(&prim)) {
+        for (size_t i{ 0 }; i < mesh->triangleCount(); ++i) {
+            uint32_t ia{ mesh->indices[i * 3] }, ib{ mesh->indices[i * 3 + 1] }, ic{ mesh->indices[i * 3 + 2] };
+            Vec2 uva, uvb(1.0, 0.0), uvc(0.0, 1.0);
+            if (mesh->hasUV()) {
+                uva = Vec2(mesh->u[ia], mesh->v[ia]);
+                uvb = Vec2(mesh->u[ib], mesh->v[ib]);
+                uvc = Vec2(mesh->u[ic], mesh->v[ic]);
+            }
+            addPlaced(mesh->position(ia), mesh->position(ib), mesh->position(ic), uva, uvb, uvc, mesh->matId);
+        }
+    }
+}
+
+void LightList::add(const Vec3 &a, const Vec3 &b, const Vec3 &c,
+    const Vec2 &uva, const Vec2 &uvb, const Vec2 &uvc, uint32_t matId) {
+    LightTriangle light;
+    light.A = a;
+    light.AB = b - a;
+    light.AC = c - a;
+    Vec3 cross{ light.AB ^ light.AC };
+    double area{ cross.length() * 0.5 };
+    if (area <= 0.0) return;
+    light.normal = cross / (area * 2.0);
+    light.uvA = uva;
+    light.uvB = uvb;
+    light.uvC = uvc;
+    light.matId = matId;
+    if (sampledMaterials.size() <= matId) sampledMaterials.resize(matId + 1, false);
+    sampledMaterials[matId] = true;
+    triangles.push_back(light);
+    totalArea += area;
+    cumulativeArea.push_back(totalArea);
+}
+
+LightSample LightList::sample(Sampler &sampler) const {
+    double pick{ sampler.rand01() * totalArea };
+    size_t i{ static_cast<size_t>(std::upper_bound(cumulativeArea.begin(), cumulativeArea.end(), pick) - cumulativeArea.begin()) };
+    const LightTriangle &light{ triangles[std::min(i, triangles.size() - 1)] };
+
+    // Uniform point in the triangle: fold the unit square along its diagonal.
+    double beta{ sampler.rand01() }, gamma{ sampler.rand01() };
+    if (beta + gamma > 1.0) {
+        beta = 1.0 - beta;
+        gamma = 1.0 - gamma;
+    }
+    double alpha{ 1.0 - beta - gamma };
+
+    LightSample s;
+    s.p = light.A + light.AB * beta + light.AC * gamma;
+    s.normal = light.normal;
+    const Material &mat{ MaterialTable::get(light.matId) };
+    s.emitted = textureValue(*mat.texture, light.uvA * alpha + light.uvB * beta + light.uvC * gamma, s.p);
+    return s;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "TriangleMesh.h"
+#include "Instance.h"
+
+struct LightSample {
+    Vec3 p, normal;  // emits towards the side normal points to
+    Color emitted;
+};
+
+struct LightList {
+    /*
+        Every emissive triangle of the scene, from Triangle primitives and TriangleMesh
+        faces whose material has LIGHT set, for next-event estimation. Those inside an
+        Instance are added once per instance, placed in the world. Other emissive
+        primitives are left to scattered rays.
+        A triangle is picked with probability area / totalArea and a point uniformly
+        inside it, so every light point has the same area pdf: 1 / totalArea.
+    */
+    struct LightTriangle {
+        Vec3 A, AB, AC, normal;
+        Vec2 uvA, uvB, uvC;
+        uint32_t matId{ 0 };
+    };
+    std::vector<LightTriangle> triangles;
+    std::vector<double> cumulativeArea;
+    double totalArea{ 0.0 };
+    std::vector<bool> sampledMaterials;  // by matId, emission of these is only gathered by sampling
+
+    LightList() = default;
+    LightList(const std::vector<primPointer> &prims);
+
+    bool empty() const { return triangles.empty(); }
+    double pdfArea() const { return 1.0 / totalArea; }
+    bool covers(uint32_t matId) const { return matId < sampledMaterials.size() && sampledMaterials[matId]; }
+    LightSample sample(Sampler &sampler) const;
+
+private:
+    // trans places the primitives of an instance's prototype, nullptr at top level.
+    void addPrimitive(const Primitive &prim, const Transformation *trans);
+    void add(const Vec3 &a, const Vec3 &b, const Vec3 &c, const Vec2 &uva, const Vec2 &uvb, const Vec2 &uvc, uint32_t matId);
+};
@@ -0,0 +1,337 @@
+#include "LinearBVH.h"
+#include "SIMD.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <future>
+#include <thread>
+
+static float roundDown(double d) {
+    float f{ static_cast<float>(d) };
+    return f > d ? std::nextafter(f, -INFINITY) : f;
+}
+
+static float roundUp(double d) {
+    float f{ static_cast<float>(d) };
+    return f < d ? std::nextafter(f, INFINITY) : f;
+}
+
+void LinearBVHNode::setBounds(const Vec3 &minB, const Vec3 &maxB) {
+    minBound[0] = roundDown(minB.x);
+    minBound[1] = roundDown(minB.y);
+    minBound[2] = roundDown(minB.z);
+    maxBound[0] = roundUp(maxB.x);
+    maxBound[1] = roundUp(maxB.y);
+    maxBound[2] = roundUp(maxB.z);
+}
+
+static void mergeBounds(LinearBVHNode &node, const LinearBVHNode &a, const LinearBVHNode &b) {
+    for (int axis{ 0 }; axis < 3; ++axis) {
+        node.minBound[axis] = std::min(a.minBound[axis], b.minBound[axis]);
+        node.maxBound[axis] = std::max(a.maxBound[axis], b.maxBound[axis]);
+    }
+}
+
+struct MotionRay {
+    // The ray as hitAt() takes it, set up once per traversal. Lane 3 matches the node padding.
+#if PBRT_SSE
+    __m128 origin, dirReciprocal, weight;
+#else
+    float origin[4], dirReciprocal[4], weight;
+#endif
+    MotionRay(const Ray &ray, float s) {
+        float o[4]{ static_cast<float>(ray.origin.x), static_cast<float>(ray.origin.y), static_cast<float>(ray.origin.z), 0.0f };
+        float r[4]{ static_cast<float>(ray.directionReciprocal.x), static_cast<float>(ray.directionReciprocal.y),
+            static_cast<float>(ray.directionReciprocal.z), INFINITY };
+#if PBRT_SSE
+        origin = _mm_loadu_ps(o);
+        dirReciprocal = _mm_loadu_ps(r);
+        weight = _mm_set1_ps(s);
+#else
+        std::copy(o, o + 4, origin);
+        std::copy(r, r + 4, dirReciprocal);
+        weight = s;
+#endif
+    }
+};
+
+static bool hitAt(const LinearBVHMotionNode &node, const MotionRay &ray, float tMin, float tMax) {
+    // Slab test on the bounds interpolated at the ray's time, all three axes at once.
+    // Slab distances that are NaN (origin on a plane the ray runs in) give way to tMin and tMax.
+#if PBRT_SSE
+    __m128 lo{ _mm_add_ps(_mm_load_ps(node.minBound), _mm_mul_ps(_mm_load_ps(node.minDelta), ray.weight)) };
+    __m128 hi{ _mm_add_ps(_mm_load_ps(node.maxBound), _mm_mul_ps(_mm_load_ps(node.maxDelta), ray.weight)) };
+    __m128 tLo{ _mm_mul_ps(_mm_sub_ps(lo, ray.origin), ray.dirReciprocal) };
+    __m128 tHi{ _mm_mul_ps(_mm_sub_ps(hi, ray.origin), ray.dirReciprocal) };
+    __m128 tNear{ _mm_max_ps(_mm_min_ps(tLo, tHi), _mm_set1_ps(tMin)) };
+    __m128 tFar{ _mm_min_ps(_mm_max_ps(tLo, tHi), _mm_set1_ps(tMax)) };
+    tNear = _mm_max_ps(tNear, _mm_shuffle_ps(tNear, tNear, _MM_SHUFFLE(1, 0, 3, 2)));
+    tNear = _mm_max_ps(tNear, _mm_shuffle_ps(tNear, tNear, _MM_SHUFFLE(2, 3, 0, 1)));
+    tFar = _mm_min_ps(tFar, _mm_shuffle_ps(tFar, tFar, _MM_SHUFFLE(1, 0, 3, 2)));
+    tFar = _mm_min_ps(tFar, _mm_shuffle_ps(tFar, tFar, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(tNear) <= _mm_cvtss_f32(tFar) * 1.0000004f;
+#else
+    for (int axis{ 0 }; axis < 3; ++axis) {
+        float tLo{ (node.minBound[axis] + node.minDelta[axis] * ray.weight - ray.origin[axis]) * ray.dirReciprocal[axis] };
+        float tHi{ (node.maxBound[axis] + node.maxDelta[axis] * ray.weight - ray.origin[axis]) * ray.dirReciprocal[axis] };
+        tMin = std::max(tMin, std::min(tLo, tHi));
+        tMax = std::min(tMax, std::max(tLo, tHi));
+    }
+    return tMin <= tMax * 1.0000004f;
+#endif
+}
+
+double LinearBVHNode::halfArea() const {
+    double x{ maxBound[0] - minBound[0] }, y{ maxBound[1] - minBound[1] }, z{ maxBound[2] - minBound[2] };
+    return x * y + y * z + z * x;
+}
+
+struct BinnedSAHBuilder::BuildNode {
+    AABB bounds;
+    std::unique_ptr<BuildNode> children[2];
+    int axis{ 0 };
+    int start{ 0 }, count{ 0 };  // primitive range, leaf only
+};
+
+void BinnedSAHBuilder::build(std::vector<BVHBuildPrim> &buildPrims, std::vector<LinearBVHNode> &nodes) const {
+    nodes.clear();
+    if (buildPrims.empty()) return;
+    auto root = buildRecursive(buildPrims, 0, static_cast<int>(buildPrims.size()), 0);
+    flatten(*root, nodes);
+}
+
+std::unique_ptr<BinnedSAHBuilder::BuildNode> BinnedSAHBuilder::buildRecursive(
+    std::vector<BVHBuildPrim> &buildPrims, int start, int end, int depth) const {
+    auto node = std::make_unique<BuildNode>();
+    int primCount{ end - start };
+
+    AABB centroidBounds;
+    for (int i{ start }; i < end; ++i) {
+        node->bounds += AABB(buildPrims[i].minBound, buildPrims[i].maxBound, 0.0);
+        centroidBounds += AABB(buildPrims[i].centroid, buildPrims[i].centroid, 0.0);
+    }
+
+    auto makeLeaf = [&]() {
+        node->start = start;
+        node->count = primCount;
+        return std::move(node);
+    };
+    if (primCount == 1) return makeLeaf();
+
+    // Score every bin border on all three axes.
+    struct Bin { AABB bounds; int count{ 0 }; };
+    double nodeArea{ node->bounds.halfArea() };
+    double bestCost{ INFINITY };
+    int bestAxis{ -1 }, bestBorder{ 0 };
+    for (int axis{ 0 }; axis < 3; ++axis) {
+        double axisMin{ centroidBounds.minBound[axis] };
+        double extent{ centroidBounds.maxBound[axis] - axisMin };
+        if (extent <= 0.0) continue;
+        double binScale{ binCount / extent };
+
+        Bin bins[binCount];
+        for (int i{ start }; i < end; ++i) {
+            int b{ std::min(binCount - 1, static_cast<int>((buildPrims[i].centroid[axis] - axisMin) * binScale)) };
+            bins[b].count++;
+            bins[b].bounds += AABB(buildPrims[i].minBound, buildPrims[i].maxBound, 0.0);
+        }
+
+        // Sweep from the right to store right side cost, then from the left to score.
+        double rightCost[binCount - 1];
+        AABB rightBounds;
+        int rightCount{ 0 };
+        for (int b{ binCount - 1 }; b > 0; --b) {
+            rightBounds += bins[b].bounds;
+            rightCount += bins[b].count;
+            rightCost[b - 1] = blocks(rightCount) * rightBounds.halfArea();
+        }
+        AABB leftBounds;
+        int leftCount{ 0 };
+        for (int b{ 0 }; b < binCount - 1; ++b) {
+            leftBounds += bins[b].bounds;
+            leftCount += bins[b].count;
+            if (!leftCount || leftCount == primCount) continue;
+            double cost{ traversalCost +
+                intersectionCost * (blocks(leftCount) * leftBounds.halfArea() + rightCost[b]) / nodeArea };
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBorder = b;
+            }
+        }
+    }
+
+    int mid{ (start + end) / 2 };
+    if (bestAxis == -1) {
+        // All centroids coincide, no border separates them.
+        if (primCount <= maxLeafSize) return makeLeaf();
+    } else {
+        if (primCount <= maxLeafSize && intersectionCost * blocks(primCount) <= bestCost) return makeLeaf();
+        double axisMin{ centroidBounds.minBound[bestAxis] };
+        double binScale{ binCount / (centroidBounds.maxBound[bestAxis] - axisMin) };
+        auto border = std::partition(buildPrims.begin() + start, buildPrims.begin() + end,
+            [=](const BVHBuildPrim &bp) -> bool {
+                return std::min(binCount - 1, static_cast<int>((bp.centroid[bestAxis] - axisMin) * binScale)) <= bestBorder;
+            });
+        mid = static_cast<int>(border - buildPrims.begin());
+        node->axis = bestAxis;
+    }
+
+    // Subtrees own disjoint ranges of buildPrims, so they can be built concurrently.
+    static const int maxParallelDepth{
+        static_cast<int>(std::log2(std::max(1u, std::thread::hardware_concurrency()))) + 2 };
+    if (primCount > 4096 && depth < maxParallelDepth) {
+        auto leftTask = std::async(std::launch::async,
+            [&]() { return buildRecursive(buildPrims, start, mid, depth + 1); });
+        node->children[1] = buildRecursive(buildPrims, mid, end, depth + 1);
+        node->children[0] = leftTask.get();
+    } else {
+        node->children[0] = buildRecursive(buildPrims, start, mid, depth + 1);
+        node->children[1] = buildRecursive(buildPrims, mid, end, depth + 1);
+    }
+    return node;
+}
+
+int BinnedSAHBuilder::flatten(const BuildNode &node, std::vector<LinearBVHNode> &nodes) const {
+    int index{ static_cast<int>(nodes.size()) };
+    nodes.emplace_back();
+    nodes[index].setBounds(node.bounds.minBound, node.bounds.maxBound);
+    if (!node.children[0]) {
+        nodes[index].offset = node.start;
+        nodes[index].primCount = static_cast<uint16_t>(node.count);
+    } else {
+        nodes[index].axis = static_cast<uint8_t>(node.axis);
+        flatten(*node.children[0], nodes);
+        nodes[index].offset = flatten(*node.children[1], nodes);
+    }
+    return index;
+}
+
+LinearBVH::LinearBVH(const BVH &bvh) {
+    box = bvh.box;
+    flatten(bvh);
+    refitMotion();
+}
+
+LinearBVH::LinearBVH(const std::vector<primPointer> &prims, int maxLeafSize) {
+    std::vector<BVHBuildPrim> buildPrims;
+    buildPrims.reserve(prims.size());
+    AABB bounds;
+    double midTime{ (Primitive::timeStart + Primitive::timeEnd) * 0.5 };
+    for (uint32_t i{ 0 }; i < prims.size(); ++i) {
+        const AABB &primBox{ prims[i]->moving ? prims[i]->boxAt(midTime) : prims[i]->box };
+        buildPrims.emplace_back(primBox.minBound, primBox.maxBound, i);
+        bounds += prims[i]->box;
+    }
+    box = AABB(bounds.minBound, bounds.maxBound, 0.0);
+
+    BinnedSAHBuilder(maxLeafSize).build(buildPrims, nodes);
+    orderedPrims.reserve(buildPrims.size());
+    for (const auto &bp : buildPrims) orderedPrims.push_back(prims[bp.index].get());
+    refitMotion();
+}
+
+void LinearBVH::refitMotion() {
+    motionNodes.clear();
+    if (std::none_of(orderedPrims.begin(), orderedPrims.end(), [](const Primitive *prim) { return prim->moving; })) return;
+    timeStart = Primitive::timeStart;
+    timeScale = Primitive::timeEnd > Primitive::timeStart ? 1.0 / (Primitive::timeEnd - Primitive::timeStart) : 0.0;
+
+    // Children always come after their parent, so one backward pass refits bottom-up.
+    std::vector<LinearBVHNode> nodesT0{ nodes }, nodesT1{ nodes };
+    for (int i{ static_cast<int>(nodes.size()) - 1 }; i >= 0; --i) {
+        LinearBVHNode &node{ nodes[i] };
+        if (node.primCount) {
+            AABB boxT0, boxT1;
+            for (int k{ node.offset }; k < node.offset + node.primCount; ++k) {
+                boxT0 += orderedPrims[k]->boxAt(Primitive::timeStart);
+                boxT1 += orderedPrims[k]->boxAt(Primitive::timeEnd);
+                node.moving |= orderedPrims[k]->moving;
+            }
+            nodesT0[i].setBounds(boxT0.minBound, boxT0.maxBound);
+            nodesT1[i].setBounds(boxT1.minBound, boxT1.maxBound);
+        } else {
+            mergeBounds(nodesT0[i], nodesT0[i + 1], nodesT0[node.offset]);
+            mergeBounds(nodesT1[i], nodesT1[i + 1], nodesT1[node.offset]);
+            node.moving = nodes[i + 1].moving | nodes[node.offset].moving;
+        }
+        mergeBounds(node, nodesT0[i], nodesT1[i]);
+    }
+
+    // Interpolation rounds off less than 2 ulp of the larger end, so both ends move out by that.
+    motionNodes.resize(nodes.size());
+    for (size_t i{ 0 }; i < nodes.size(); ++i) {
+        const LinearBVHNode &t0{ nodesT0[i] }, &t1{ nodesT1[i] };
+        for (int axis{ 0 }; axis < 3; ++axis) {
+            float lo{ (std::fabs(t0.minBound[axis]) + std::fabs(t1.minBound[axis])) * 2.0f * FLT_EPSILON };
+            float hi{ (std::fabs(t0.maxBound[axis]) + std::fabs(t1.maxBound[axis])) * 2.0f * FLT_EPSILON };
+            motionNodes[i].minBound[axis] = t0.minBound[axis] - lo;
+            motionNodes[i].maxBound[axis] = t0.maxBound[axis] + hi;
+            motionNodes[i].minDelta[axis] = t1.minBound[axis] - t0.minBound[axis];
+            motionNodes[i].maxDelta[axis] = t1.maxBound[axis] - t0.maxBound[axis];
+        }
+    }
+}
+
+double LinearBVH::sahCost(double traversalCost, double intersectionCost) const {
+    if (nodes.empty()) return 0.0;
+    double cost{ 0.0 };
+    for (const auto &node : nodes) {
+        cost += node.halfArea() * (node.primCount ? intersectionCost * node.primCount : traversalCost);
+    }
+    return cost / nodes[0].halfArea();
+}
+
+int LinearBVH::flatten(const BVH &node) {
+    int index{ static_cast<int>(nodes.size()) };
+    nodes.emplace_back();
+    nodes[index].setBounds(node.box.minBound, node.box.maxBound);
+
+    // BVH children are either both BVH nodes, or both primitives (left == right for single leaf).
+    auto leftNode = dynamic_cast<const BVH *>(node.left.get());
+    auto rightNode = dynamic_cast<const BVH *>(node.right.get());
+    if (!leftNode || !rightNode) {
+        nodes[index].offset = static_cast<int32_t>(orderedPrims.size());
+        orderedPrims.push_back(node.left.get());
+        if (node.right != node.left) orderedPrims.push_back(node.right.get());
+        nodes[index].primCount = static_cast<uint16_t>(orderedPrims.size() - nodes[index].offset);
+    } else {
+        // BVH sorted its primitives along the longest axis before splitting.
+        Vec3 len{ node.box.maxBound - node.box.minBound };
+        nodes[index].axis = len.x >= len.y && len.x >= len.z ? 0 : (len.y >= len.z ? 1 : 2);
+        flatten(*leftNode);
+        nodes[index].offset = flatten(*rightNode);
+    }
+    return index;
+}
+
+bool LinearBVH::hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const {
+    auto intersectLeaf = [&](int offset, int primCount, double &tMaxLeaf) {
+        bool hitLeaf{ false };
+        for (int i{ 0 }; i < primCount; ++i) {
+            if (orderedPrims[offset + i]->hit(ray, tMin, tMaxLeaf, rec)) {
+                hitLeaf = true;
+                tMaxLeaf = rec.t;
+            }
+        }
+        return hitLeaf;
+    };
+    if (motionNodes.empty()) return traverseLinearBVH(nodes, ray, tMin, tMax, intersectLeaf);
+
+    const MotionRay motionRay(ray, static_cast<float>(std::min(std::max((ray.time - timeStart) * timeScale, 0.0), 1.0)));
+    return traverseLinearBVH(nodes, ray, tMin, tMax, intersectLeaf,
+        [&](int index, const float origin[3], const float dirReciprocal[3], const int dirIsNeg[3], float t0, float t1) {
+            const LinearBVHNode &node{ nodes[index] };
+            if (!node.moving) return node.hit(origin, dirReciprocal, dirIsNeg, t0, t1);
+            return hitAt(motionNodes[index], motionRay, t0, t1);
+        });
+}
+
+void LinearBVH::printSelf() const {
+    int leafCount{ 0 };
+    for (const auto &node : nodes) if (node.primCount) ++leafCount;
+    std::cout << "LinearBVH: " << nodes.size() << " nodes, " << leafCount << " leaves, "
+        << orderedPrims.size() << " primitives, "
+        << nodes.size() * sizeof(LinearBVHNode) << " bytes"
+        << (motionNodes.empty() ? "" : ", time-interpolated bounds") << std::endl;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include "Primitive.h"
+
+// How LinearBVH is built: flattened from the sorted SAH tree of BVH, or binned SAH directly.
+enum BVH_BUILDER { SORTED_SAH, BINNED_SAH };
+
+struct LinearBVHNode {
+    // 32 bytes, two nodes per cache line.
+    // Bounds are stored as float, rounded outward so the box never shrinks.
+    float minBound[3]{ INFINITY, INFINITY, INFINITY };
+    float maxBound[3]{ -INFINITY, -INFINITY, -INFINITY };
+    // Leaf: index of first primitive in orderedPrims.
+    // Interior: index of second child. First child always follows its parent directly.
+    int32_t offset{ 0 };
+    uint16_t primCount{ 0 };  // 0 for interior node
+    uint8_t axis{ 0 };  // split axis of interior node, decides near/far child
+    uint8_t moving{ 0 };  // subtree holds moving primitives, LinearBVH interpolates its bounds
+
+    void setBounds(const Vec3 &minB, const Vec3 &maxB);
+    double halfArea() const;
+    bool hit(const float origin[3], const float dirReciprocal[3], const int dirIsNeg[3],
+        float tMin, float tMax) const;
+};
+static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode should stay 32 bytes");
+
+struct alignas(64) LinearBVHMotionNode {
+    // Bounds of a node at Primitive::timeStart and their change until timeEnd, one cache line.
+    // Lane 3 is padding that never culls: [-1, 1] against an infinite reciprocal direction.
+    float minBound[4]{ 0.0f, 0.0f, 0.0f, -1.0f };
+    float maxBound[4]{ 0.0f, 0.0f, 0.0f, 1.0f };
+    float minDelta[4]{ 0.0f, 0.0f, 0.0f, 0.0f };
+    float maxDelta[4]{ 0.0f, 0.0f, 0.0f, 0.0f };
+};
+
+struct BVHBuildPrim {
+    // What the builder needs to know about one primitive. index points back to the caller's array.
+    Vec3 minBound, maxBound, centroid;
+    uint32_t index{ 0 };
+
+    BVHBuildPrim() = default;
+    BVHBuildPrim(const Vec3 &minB, const Vec3 &maxB, uint32_t i) :
+        minBound(minB), maxBound(maxB), centroid((minB + maxB) * 0.5), index(i) {}
+};
+
+struct BinnedSAHBuilder {
+    /*
+        Binned SAH: instead of sorting, centroids are dropped into binCount equal
+        slots along each axis, and only the binCount-1 bin borders are scored.
+        Scoring uses the area of the merged bounds on each side:
+            cost = traversalCost + intersectionCost * (nL * A(L) + nR * A(R)) / A(node)
+        A node becomes a leaf once it is small enough and no split beats
+            intersectionCost * n.
+        With blockWidth > 1 primitives are tested that many at a time, so n of them
+        count as ceil(n / blockWidth) in both formulas and full leaves win.
+        Large subtrees are built in parallel.
+    */
+    static constexpr int binCount{ 16 };
+    int maxLeafSize{ 4 };
+    int blockWidth{ 1 };
+    double traversalCost{ 1.0 };
+    double intersectionCost{ 1.0 };
+
+    BinnedSAHBuilder() = default;
+    BinnedSAHBuilder(int leafSize) : maxLeafSize(leafSize) {}
+    // Reorders buildPrims so every leaf references a contiguous range [offset, offset + primCount).
+    void build(std::vector<BVHBuildPrim> &buildPrims, std::vector<LinearBVHNode> &nodes) const;
+
+private:
+    struct BuildNode;
+    double blocks(int primCount) const { return (primCount + blockWidth - 1) / blockWidth; }
+    std::unique_ptr<BuildNode> buildRecursive(std::vector<BVHBuildPrim> &buildPrims, int start, int end, int depth) const;
+    int flatten(const BuildNode &node, std::vector<LinearBVHNode> &nodes) const;
+};
+
+template <int N>
+struct RayPacket;
+
+struct LinearBVH : public Primitive {
+    // Pointer-free BVH: depth-first node array, traversed with an explicit stack.
+    // Primitives are not owned, the prims vector used for building must outlive this.
+    std::vector<LinearBVHNode> nodes;
+    std::vector<const Primitive *> orderedPrims;
+    /*
+        With moving primitives every node above one also has its bounds at Primitive::timeStart
+        and timeEnd, and hit() tests the box interpolated at ray.time: linear motion stays
+        inside it, so a fast primitive only widens its nodes around where it is at that time.
+        nodes then hold the union over the whole interval, for wide BVHs and packets.
+        The binned builder groups moving primitives by their bounds at mid interval.
+    */
+    std::vector<LinearBVHMotionNode> motionNodes;  // empty when nothing moves
+    double timeStart{ 0.0 }, timeScale{ 0.0 };  // ray.time to interpolation weight
+
+    LinearBVH() = default;
+    LinearBVH(const BVH &bvh);  // flatten the SAH tree built by BVH
+    LinearBVH(const std::vector<primPointer> &prims, int maxLeafSize = 4);  // binned SAH
+
+    // SAH cost of the finished tree, comparable across builders.
+    double sahCost(double traversalCost = 1.0, double intersectionCost = 1.0) const;
+
+    bool hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const override;
+    // Trace N rays together, returns the mask of lanes that hit. Defined in RayPacket.h.
+    template <int N>
+    int hitPacket(RayPacket<N> &packet) const;
+    void makeAABB() override {}
+    virtual void printSelf() const override;
+    virtual Vec2 uv(const Vec3 &p) const override { return Vec2(); }
+    virtual void transform(const Transformation &trans) override {}
+
+private:
+    int flatten(const BVH &node);
+    void refitMotion();
+};
+
+template <typename LeafIntersector>
+bool traverseLinearBVH(const std::vector<LinearBVHNode> &nodes, const Ray &ray, double tMin, double &tMax,
+    const LeafIntersector &intersectLeaf);
+template <typename LeafIntersector, typename NodeTest>
+bool traverseLinearBVH(const std::vector<LinearBVHNode> &nodes, const Ray &ray, double tMin, double &tMax,
+    const LeafIntersector &intersectLeaf, const NodeTest &nodeHit);
+
+inline bool LinearBVHNode::hit(
+    const float origin[3], const float dirReciprocal[3], const int dirIsNeg[3],
+    float tMin, float tMax) const {
+    // Slab test without swaps: pick near/far plane by ray direction sign.
+    const float *bounds[2]{ minBound, maxBound };
+    float t0x{ (bounds[dirIsNeg[0]][0] - origin[0]) * dirReciprocal[0] };
+    float t1x{ (bounds[1 - dirIsNeg[0]][0] - origin[0]) * dirReciprocal[0] };
+    float t0y{ (bounds[dirIsNeg[1]][1] - origin[1]) * dirReciprocal[1] };
+    float t1y{ (bounds[1 - dirIsNeg[1]][1] - origin[1]) * dirReciprocal[1] };
+    float t0z{ (bounds[dirIsNeg[2]][2] - origin[2]) * dirReciprocal[2] };
+    float t1z{ (bounds[1 - dirIsNeg[2]][2] - origin[2]) * dirReciprocal[2] };
+    tMin = std::max(tMin, std::max(t0x, std::max(t0y, t0z)));
+    tMax = std::min(tMax, std::min(t1x, std::min(t1y, t1z)));
+    // Float rounding of the slab distances, keep grazing rays.
+    return tMin <= tMax * 1.0000004f;
+}
+
+template <typename LeafIntersector>
+inline bool traverseLinearBVH(const std::vector<LinearBVHNode> &nodes, const Ray &ray, double tMin, double &tMax,
+    const LeafIntersector &intersectLeaf) {
+    return traverseLinearBVH(nodes, ray, tMin, tMax, intersectLeaf,
+        [&nodes](int index, const float origin[3], const float dirReciprocal[3], const int dirIsNeg[3], float t0, float t1) {
+            return nodes[index].hit(origin, dirReciprocal, dirIsNeg, t0, t1);
+        });
+}
+
+template <typename LeafIntersector, typename NodeTest>
+inline bool traverseLinearBVH(const std::vector<LinearBVHNode> &nodes, const Ray &ray, double tMin, double &tMax,
+    const LeafIntersector &intersectLeaf, const NodeTest &nodeHit) {
+    // Shared by every structure built on LinearBVHNode.
+    // intersectLeaf(offset, primCount, tMax) tests one leaf, shrinks tMax and returns true on a hit.
+    // nodeHit(index, ...) tests the bounds of nodes[index], with the arguments of LinearBVHNode::hit.
+    if (nodes.empty()) return false;
+
+    const float origin[3]{
+        static_cast<float>(ray.origin.x), static_cast<float>(ray.origin.y), static_cast<float>(ray.origin.z) };
+    const float dirReciprocal[3]{
+        static_cast<float>(ray.directionReciprocal.x),
+        static_cast<float>(ray.directionReciprocal.y),
+        static_cast<float>(ray.directionReciprocal.z) };
+    const int dirIsNeg[3]{ !ray.xPositive, !ray.yPositive, !ray.zPositive };
+    float tMinF{ static_cast<float>(tMin) };
+
+    // Nodes still to visit. 64 is far beyond the depth of any SAH tree we build.
+    int stack[64];
+    int stackSize{ 0 };
+    int current{ 0 };
+    bool hitAnything{ false };
+
+    while (true) {
+        const LinearBVHNode &node{ nodes[current] };
+        // tMax shrinks with every hit, so far nodes popped later are culled here.
+        if (nodeHit(current, origin, dirReciprocal, dirIsNeg, tMinF, static_cast<float>(tMax))) {
+            if (node.primCount) {
+                if (intersectLeaf(node.offset, node.primCount, tMax)) hitAnything = true;
+                if (!stackSize) break;
+                current = stack[--stackSize];
+            } else {
+                // Visit near child first, postpone far child.
+                if (dirIsNeg[node.axis]) {
+                    stack[stackSize++] = current + 1;
+                    current = node.offset;
+                } else {
+                    stack[stackSize++] = node.offset;
+                    current = current + 1;
+                }
+            }
+        } else {
+            if (!stackSize) break;
+            current = stack[--stackSize];
+        }
+    }
+    return hitAnything;
+}
@@ -1,25 +1,49 @@
 #include "Material.h"
+#include <typeinfo>
 
-Vec3 Material::randomSampleInHemiSphere(const Vec3 &normal, double &cosTheta, double range) const {
+std::vector<std::unique_ptr<Material>> MaterialTable::materials;
+
+void MaterialTable::classify(Material &mat) {
+    // Exact type only: a subclass may override scatter, so it keeps the virtual calls.
+    if (typeid(mat) == typeid(Lambertian)) mat.type = LAMBERTIAN_MATERIAL;
+    else if (typeid(mat) == typeid(Metal)) mat.type = METAL_MATERIAL;
+    else if (typeid(mat) == typeid(Dielectric)) mat.type = DIELECTRIC_MATERIAL;
+    else if (typeid(mat) == typeid(DiffuseLight)) mat.type = DIFFUSE_LIGHT_MATERIAL;
+    else if (typeid(mat) == typeid(Isotropic)) mat.type = ISOTROPIC_MATERIAL;
+    else mat.type = OTHER_MATERIAL;
+    if (mat.texture) classifyTexture(*mat.texture);
+}
+
+Vec3 Material::randomSampleInHemiSphere(const Vec3 &normal, double &cosTheta, Sampler &sampler, double range) const {
     // λ https://zhuanlan.zhihu.com/p/340929847
 
     /*
         r0 = rand01(), r1 = rand01(). r0,r1: [0,1)
           phi = r0 * 2 * PI
-        theta = acos(1 - r1)
+        theta = acos(1 - r1 * range)
 
         cos(phi) = cos(2*PI*r0)
         sin(phi) = sin(2*PI*r0)
-        cos(theta) = 1 - r1
-        sin(theta) = sqrt(1 - cos^2(theta)) = sqrt(2*r1-r1*r1)
-            (For theta is on the interval of [0, PI /2], sin(theta)>=0.)
+        cos(theta) = 1 - r1 * range
+        sin(theta) = sqrt(1 - cos^2(theta))
+            (For theta is on the interval of [0, PI], sin(theta)>=0.)
     */
-    double r0{ rand01() }, r1{ rand01() };
-    cosTheta = 1.0 - r1;
-    double phi{2.0 * PI * r0}, sinTheta{ sqrt(1.0 - cosTheta * cosTheta) };
-    Vec3 pos{ cos(phi) * sinTheta, cosTheta, sin(phi) * sinTheta };
+    double r0{ sampler.rand01() }, r1{ sampler.rand01() };
+    cosTheta = 1.0 - r1 * range;
+    double phi{2.0 * PI * r0}, sinTheta{ sqrt(std::max(0.0, 1.0 - cosTheta * cosTheta)) };
+    return alignToNormal(Vec3(cos(phi) * sinTheta, cosTheta, sin(phi) * sinTheta), normal);
+}
+
+Vec3 Material::cosineSampleInHemiSphere(const Vec3 &normal, double &cosTheta, Sampler &sampler) const {
+    // Malley's method: cos(theta) = sqrt(1 - r1), uniform in the projected disk.
+    double r0{ sampler.rand01() }, r1{ sampler.rand01() };
+    cosTheta = sqrt(1.0 - r1);
+    double phi{ 2.0 * PI * r0 }, sinTheta{ sqrt(r1) };
+    return alignToNormal(Vec3(cos(phi) * sinTheta, cosTheta, sin(phi) * sinTheta), normal);
+}
 
-    
+Vec3 Material::alignToNormal(const Vec3 &pos, const Vec3 &normal) {
+    // Rotate pos, given around up(0, 1, 0), to the same place around normal.
 
     if (fabs(normal.x) < 0.00001 && fabs(normal.z) < 0.00001) {
         // When normal almost pointing up(0, 1, 0)
@@ -48,7 +72,7 @@ double Dielectric::schlick(double cosine) const {
     return r0 + (1.0 - r0) * pow(1 - cosine, 5);
 }
 
-Vec3 Dielectric::refract(const Vec3 &dirIn, const Vec3 &normal) const {
+Vec3 Dielectric::refract(const Vec3 &dirIn, const Vec3 &normal, Sampler &sampler) const {
     // Snell's law: n1 * sin o1 = n2 * sin o2
     double cosineIn{ dirIn * normal };  // ǵcos
 
@@ -58,7 +82,7 @@ Vec3 Dielectric::refract(const Vec3 &dirIn, const Vec3 &normal) const {
 
         // reflectivity
         double reflectProb{ schlick(-cosineIn) };
-        if(rand01() < reflectProb) return reflect(dirIn, normal);
+        if(sampler.rand01() < reflectProb) return reflect(dirIn, normal);
         else return IORR *(dirIn - cosineIn * normal) - normal * cosineOut;
     }
     else {
@@ -71,7 +95,7 @@ Vec3 Dielectric::refract(const Vec3 &dirIn, const Vec3 &normal) const {
         else {
             // reflectivity
             double reflectProb{ schlick(IOR * cosineIn) };
-            if (rand01() < reflectProb) return reflect(dirIn, -normal);
+            if (sampler.rand01() < reflectProb) return reflect(dirIn, -normal);
             else return IOR * (dirIn - cosineIn * normal) + normal * sqrt(discriminant);
         }
     }
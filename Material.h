@@ -5,19 +5,63 @@
 #include "Color.h"
 #include "Texture.h"
 #include <tuple>
+#include <vector>
+#include <memory>
+#include <cassert>
+#include <cstdint>
+
+// matId of a primitive or HitRec no material was given to.
+constexpr uint32_t NO_MATERIAL{ UINT32_MAX };
 
 struct Material;
 struct HitRec {
     double t{ 0.0 };
-    Vec3 p, normal;
+    Vec3 p, normal;  // normal may be interpolated from vertex normals, for shading
+    Vec3 geometricNormal;  // of the surface itself: emission and light sampling face this way
     Vec2 uv;
-    std::shared_ptr<Material> mat;
+    uint32_t matId{ NO_MATERIAL };  // index into MaterialTable
+    Sampler *sampler{ nullptr };  // set by the integrator, for primitives that sample during hit()
+    bool shadow{ false };  // shadow ray: volumes do not block it, their transmittance is applied instead
+};
+
+struct MaterialTable {
+    // Scene-wide owner of every material. Primitives and HitRec refer to materials by index,
+    // so recording a hit copies 4 bytes instead of touching a shared_ptr refcount.
+    // Filled while the scene is built, read-only while rendering. clear() before building
+    // the next scene, or the materials of every earlier one stay registered.
+    static std::vector<std::unique_ptr<Material>> materials;
+
+    template <typename MaterialType>
+    static uint32_t add(const MaterialType &m) {
+        materials.push_back(std::make_unique<MaterialType>(m));
+        classify(*materials.back());
+        return static_cast<uint32_t>(materials.size() - 1);
+    }
+    static uint32_t add(uint32_t matId) { return matId; }  // already registered
+    static const Material &get(uint32_t matId) {
+        assert(matId < materials.size() && "matId is not in MaterialTable");
+        return *materials[matId];
+    }
+    // Ids handed out before are invalid afterwards.
+    static void clear() { materials.clear(); }
+
+private:
+    // Tags a registered material and its textures with their exact types for the switch dispatch.
+    static void classify(Material &mat);
+};
+
+// Built-in material types, dispatched with a switch by scatterOf / evalOf / pdfOf.
+// OTHER_MATERIAL, subclasses included, keeps the virtual calls.
+enum MATERIAL_TYPE {
+    LAMBERTIAN_MATERIAL, METAL_MATERIAL, DIELECTRIC_MATERIAL, DIFFUSE_LIGHT_MATERIAL, ISOTROPIC_MATERIAL, OTHER_MATERIAL
 };
 
 struct Material {
     double reflectance{ 1.0 };
     bool LIGHT{ false };
+    bool SPECULAR{ false };  // scatters into a single direction, eval and pdf are 0 for any other
     std::shared_ptr<Texture> texture;
+    MATERIAL_TYPE type{ OTHER_MATERIAL };  // set by MaterialTable::add
 
     Material() = default;
     Material(const PALETTE &p, double r = 1.0) :
@@ -28,41 +72,80 @@ struct Material {
     Material(const TextureType &t, double r = 1.0) :
         texture(std::make_shared<TextureType>(t)), reflectance(r) {}
     Vec3 reflect(const Vec3 &in, const Vec3 &normal) const { return in - 2 * (in * normal) * normal; }
-    Vec3 randomSampleInHemiSphere(const Vec3 &normal, double &cosTheta, double range = 1.0) const;
-    Vec3 randomSampleInSphere() const {
-        float phi = rand01() * 2.0 * PI;
-        float theta = acos(1.0 - 2 * rand01());
+    // Uniform over the cap of directions with cosTheta in [1 - range, 1] around normal. pdf: 1 / (2PI * range)
+    Vec3 randomSampleInHemiSphere(const Vec3 &normal, double &cosTheta, Sampler &sampler, double range = 1.0) const;
+    // Cosine weighted over the hemisphere around normal. pdf: cosTheta / PI
+    Vec3 cosineSampleInHemiSphere(const Vec3 &normal, double &cosTheta, Sampler &sampler) const;
+    static Vec3 alignToNormal(const Vec3 &pos, const Vec3 &normal);
+    Vec3 randomSampleInSphere(Sampler &sampler) const {
+        float phi = sampler.rand01() * 2.0 * PI;
+        float theta = acos(1.0 - 2 * sampler.rand01());
         double sinTheta{ sin(theta) };
         return Vec3(sinTheta * cos(phi), cos(theta), sinTheta * sin(phi));
     }
-    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF) const = 0;
+    /*
+        scatter: sample an outgoing direction, PDF is its solid angle density (1.0 for SPECULAR).
+        eval: BSDF * cosine towards a given normalized direction, albedo and reflectance excluded.
+        pdf: density scatter would have sampled that direction with.
+        A scattered path is weighted by albedo * reflectance * eval / PDF.
+    */
+    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF, Sampler &sampler) const = 0;
+    virtual double eval(const Ray &rayIn, const HitRec &rec, const Vec3 &direction) const { return 0.0; }
+    virtual double pdf(const Ray &rayIn, const HitRec &rec, const Vec3 &direction) const { return 0.0; }
 };
 
 struct Lambertian : public Material {
     Lambertian() = default;
     template <typename TextureType>
     Lambertian(const TextureType &t, double r = 1.0) : Material(t, r) {}
-    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF) const override {
+    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF, Sampler &sampler) const override {
         double cosTheta;
-        Vec3 &&dir = randomSampleInHemiSphere(rec.normal, cosTheta);
+        Vec3 &&dir = cosineSampleInHemiSphere(rec.normal, cosTheta, sampler);
         PDF = cosTheta * PI_RECIPROCAL;
         return Ray(rec.p, dir, rayIn.time);
     }
+    // BSDF 1/PI, sampled exactly in proportion to eval.
+    virtual double eval(const Ray &rayIn, const HitRec &rec, const Vec3 &direction) const override {
+        return std::max<double>(0.0, rec.normal * direction) * PI_RECIPROCAL;
+    }
+    virtual double pdf(const Ray &rayIn, const HitRec &rec, const Vec3 &direction) const override {
+        return std::max<double>(0.0, rec.normal * direction) * PI_RECIPROCAL;
+    }
 };
 
 struct Metal : public Material {
     double fuzz{ 0.0 };
 
     Metal() = default;
+    // fuzz is clamped to [0, 2], at 2 the cap below is the whole sphere.
     template <typename TextureType>
-    Metal(const TextureType &t, double f = 0.0, double r = 1.0) : Material(t, r), fuzz(f) {}
+    Metal(const TextureType &t, double f = 0.0, double r = 1.0) :
+        Material(t, r), fuzz(std::min(std::max(f, 0.0), 2.0)) { Material::SPECULAR = fuzz == 0.0; }
 
-    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF) const override {
+    // fuzz > 0: uniform lobe over the cap cosTheta >= 1 - fuzz around the mirror direction.
+    // The part of the cap below the surface is absorbed: PDF 0 for those samples.
+    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF, Sampler &sampler) const override {
         PDF = 1.0;
         double cosTheta;
         Vec3 reflected{ reflect(rayIn.direction.normalized(), rec.normal)};
         if (fuzz == 0.0) return Ray(rec.p, reflected, rayIn.time);
-        else return Ray(rec.p, randomSampleInHemiSphere(reflected, cosTheta, fuzz), rayIn.time);
+        Vec3 direction{ randomSampleInHemiSphere(reflected, cosTheta, sampler, fuzz) };
+        PDF = aboveSurface(rec, reflected, direction) ? 0.5 * PI_RECIPROCAL / fuzz : 0.0;
+        return Ray(rec.p, direction, rayIn.time);
+    }
+    virtual double eval(const Ray &rayIn, const HitRec &rec, const Vec3 &direction) const override {
+        return pdf(rayIn, rec, direction);
+    }
+    virtual double pdf(const Ray &rayIn, const HitRec &rec, const Vec3 &direction) const override {
+        if (fuzz == 0.0) return 0.0;
+        Vec3 reflected{ reflect(rayIn.direction.normalized(), rec.normal) };
+        return reflected * direction >= 1.0 - fuzz && aboveSurface(rec, reflected, direction) ? 0.5 * PI_RECIPROCAL / fuzz : 0.0;
+    }
+
+private:
+    // On the side of the surface the mirror direction leaves to, whichever way the normal faces.
+    static bool aboveSurface(const HitRec &rec, const Vec3 &reflected, const Vec3 &direction) {
+        return (direction * rec.normal) * (reflected * rec.normal) > 0.0;
     }
 };
 
@@ -72,24 +155,24 @@ struct Dielectric : public Material {
     Dielectric() = default;
     template <typename TextureType>
     Dielectric(const TextureType &t, double ior = 1.44, double r = 1.0) :
-        Material(t, r), IOR(ior), IORR(1.0 / ior), criticalAngle(asin(1.0 / IOR)) {}
+        Material(t, r), IOR(ior), IORR(1.0 / ior), criticalAngle(asin(1.0 / IOR)) { Material::SPECULAR = true; }
 
-    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF) const override {
+    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF, Sampler &sampler) const override {
         PDF = 1.0;
-        return Ray(rec.p, refract(rayIn.direction.normalized(), rec.normal), rayIn.time);
+        return Ray(rec.p, refract(rayIn.direction.normalized(), rec.normal, sampler), rayIn.time);
     }
 
 private:
     double criticalAngle{ asin(1.0 / 1.44) };  // ٽ
     double schlick(double cosine) const;
-    Vec3 refract(const Vec3 &dirIn, const Vec3 &normal) const;
+    Vec3 refract(const Vec3 &dirIn, const Vec3 &normal, Sampler &sampler) const;
 };
 
 struct DiffuseLight : public Material {
     DiffuseLight() = default;
     template <typename TextureType>
     DiffuseLight(const TextureType &t) : Material(t, 0.0) { Material::LIGHT = true; }
-    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF) const override {
+    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF, Sampler &sampler) const override {
         PDF = 1.0; return Ray();
     }
 };
@@ -98,7 +181,54 @@ struct Isotropic : public Material {
     Isotropic() = default;
     template <typename TextureType>
     Isotropic(const TextureType &t, double r = 1.0) : Material(t, r) {}
-    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF) const override {
-        PDF = 1.0; return Ray(rec.p, randomSampleInSphere(), rayIn.time);
+    virtual Ray scatter(const Ray &rayIn, const HitRec &rec, double &PDF, Sampler &sampler) const override {
+        PDF = 0.25 * PI_RECIPROCAL; return Ray(rec.p, randomSampleInSphere(sampler), rayIn.time);
+    }
+    // Phase function of uniform scattering, 1/(4PI) in every direction.
+    virtual double eval(const Ray &rayIn, const HitRec &rec, const Vec3 &direction) const override {
+        return 0.25 * PI_RECIPROCAL;
+    }
+    virtual double pdf(const Ray &rayIn, const HitRec &rec, const Vec3 &direction) const override {
+        return 0.25 * PI_RECIPROCAL;
+    }
+};
+
+/*
+    Closed-set dispatch: same results as the virtual calls, but the built-in types are
+    called by qualified name, so Lambertian + ConstantTexture inlines into the integrator.
+    The virtual API stays the extension point, anything else falls through to it.
+*/
+inline Color albedoOf(const Material &mat, const HitRec &rec) { return textureValue(*mat.texture, rec.uv, rec.p); }
+
+inline Ray scatterOf(const Material &mat, const Ray &rayIn, const HitRec &rec, double &PDF, Sampler &sampler) {
+    switch (mat.type) {
+    case LAMBERTIAN_MATERIAL: return static_cast<const Lambertian &>(mat).Lambertian::scatter(rayIn, rec, PDF, sampler);
+    case METAL_MATERIAL: return static_cast<const Metal &>(mat).Metal::scatter(rayIn, rec, PDF, sampler);
+    case DIELECTRIC_MATERIAL: return static_cast<const Dielectric &>(mat).Dielectric::scatter(rayIn, rec, PDF, sampler);
+    case DIFFUSE_LIGHT_MATERIAL: return static_cast<const DiffuseLight &>(mat).DiffuseLight::scatter(rayIn, rec, PDF, sampler);
+    case ISOTROPIC_MATERIAL: return static_cast<const Isotropic &>(mat).Isotropic::scatter(rayIn, rec, PDF, sampler);
+    default: return mat.scatter(rayIn, rec, PDF, sampler);
+    }
+}
+
+inline double evalOf(const Material &mat, const Ray &rayIn, const HitRec &rec, const Vec3 &direction) {
+    switch (mat.type) {
+    case LAMBERTIAN_MATERIAL: return static_cast<const Lambertian &>(mat).Lambertian::eval(rayIn, rec, direction);
+    case METAL_MATERIAL: return static_cast<const Metal &>(mat).Metal::eval(rayIn, rec, direction);
+    case ISOTROPIC_MATERIAL: return static_cast<const Isotropic &>(mat).Isotropic::eval(rayIn, rec, direction);
+    case DIELECTRIC_MATERIAL:
+    case DIFFUSE_LIGHT_MATERIAL: return mat.Material::eval(rayIn, rec, direction);
+    default: return mat.eval(rayIn, rec, direction);
+    }
+}
+
+inline double pdfOf(const Material &mat, const Ray &rayIn, const HitRec &rec, const Vec3 &direction) {
+    switch (mat.type) {
+    case LAMBERTIAN_MATERIAL: return static_cast<const Lambertian &>(mat).Lambertian::pdf(rayIn, rec, direction);
+    case METAL_MATERIAL: return static_cast<const Metal &>(mat).Metal::pdf(rayIn, rec, direction);
+    case ISOTROPIC_MATERIAL: return static_cast<const Isotropic &>(mat).Isotropic::pdf(rayIn, rec, direction);
+    case DIELECTRIC_MATERIAL:
+    case DIFFUSE_LIGHT_MATERIAL: return mat.Material::pdf(rayIn, rec, direction);
+    default: return mat.pdf(rayIn, rec, direction);
     }
-};
\ No newline at end of file
+}
@@ -36,7 +36,8 @@ bool Sphere::hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const {
         rec.t = root;
         rec.p = ray.pointAtT(root);
         rec.normal = (rec.p - actualCenter) / radius;
-        rec.mat = mat;
+        rec.geometricNormal = rec.normal;
+        rec.matId = matId;
 
         // Move center to origin, and make sphere unit size.
         rec.uv = uv((rec.p - center) / radius);
@@ -69,7 +70,8 @@ bool Triangle::hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const
     rec.t = t;
     rec.p = ray.pointAtT(t);
     rec.normal = normal;
-    rec.mat = mat;
+    rec.geometricNormal = normal;
+    rec.matId = matId;
     rec.uv = uv(Vec3(1.0 - gamma - beta, beta, gamma));
     return true;
 }
@@ -186,6 +188,7 @@ void BVH::printSelf() const {
 }
 
 bool Volume::hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const {
+    if (rec.shadow) return false;
     Ray transRay(ray.origin * tfi, ray.direction * rot);
 
     const std::tuple<double, double> &twoT{ volumeBoundary.hit(transRay) };
@@ -195,15 +198,69 @@ bool Volume::hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const {
     // Now the ray is really hit the box, but just the bounding box.
 
     if (t0 < tMin) t0 = tMin;
-    if (t1 > tMax) t0 = tMax;
-
-    // Distance between two hitting points. Absolute distance
-    double distance{ (t1 - t0) * transRay.direction.length() };
-    // Where would we think the ray is hitting this volume. Also absolute distance.
-    double hitDistance{ log(rand11()) / -density };
-    if (hitDistance >= distance) return false;
-    rec.t = t0 + hitDistance / transRay.direction.length();
+    if (t1 > tMax) t1 = tMax;
+
+    Sampler &sampler{ rec.sampler ? *rec.sampler : threadSampler() };
+    double directionLength{ transRay.direction.length() };
+    if (!field) {
+        // Distance between two hitting points. Absolute distance
+        double distance{ (t1 - t0) * directionLength };
+        // Where would we think the ray is hitting this volume. Also absolute distance.
+        double hitDistance{ log(sampler.rand11()) / -density };
+        if (hitDistance >= distance) return false;
+        rec.t = t0 + hitDistance / directionLength;
+    } else {
+        // Delta tracking: tentative collisions at the cell's majorant rate, each one real
+        // with probability density / majorant. Empty cells are skipped without a sample.
+        bool collided{ false };
+        majorants.traverse(transRay, t0, t1, [&](double cellT0, double cellT1, double majorant) {
+            if (majorant <= 0.0) return true;
+            double t{ cellT0 };
+            for (;;) {
+                t -= log(1.0 - sampler.rand01()) / (majorant * directionLength);
+                if (t >= cellT1) return true;
+                if (sampler.rand01() * majorant < field->density(transRay.pointAtT(t))) {
+                    rec.t = t;
+                    collided = true;
+                    return false;
+                }
+            }
+        });
+        if (!collided) return false;
+    }
     rec.p = transRay.pointAtT(rec.t) * tf;
-    rec.mat = mat;
+    rec.matId = matId;
     return true;
+}
+
+double Volume::transmittance(const Ray &ray, double tMin, double tMax, Sampler &sampler) const {
+    Ray transRay(ray.origin * tfi, ray.direction * rot);
+    const std::tuple<double, double> &twoT{ volumeBoundary.hit(transRay) };
+    double t0{ std::max(std::get<0>(twoT), tMin) }, t1{ std::min(std::get<1>(twoT), tMax) };
+    if (t0 >= t1) return 1.0;
+
+    double directionLength{ transRay.direction.length() };
+    if (!field) return exp(-density * (t1 - t0) * directionLength);
+
+    // Ratio tracking: every tentative collision keeps the null fraction 1 - density / majorant
+    // instead of ending the walk, so the estimate is smooth. Russian roulette below 0.1 ends
+    // long walks through thick media without bias.
+    double T{ 1.0 };
+    majorants.traverse(transRay, t0, t1, [&](double cellT0, double cellT1, double majorant) {
+        if (majorant <= 0.0) return true;
+        double t{ cellT0 };
+        for (;;) {
+            t -= log(1.0 - sampler.rand01()) / (majorant * directionLength);
+            if (t >= cellT1) return true;
+            T *= std::max(0.0, 1.0 - field->density(transRay.pointAtT(t)) / majorant);
+            if (T < 0.1) {
+                if (T <= 0.0 || sampler.rand01() >= 0.5) {
+                    T = 0.0;
+                    return false;
+                }
+                T *= 2.0;
+            }
+        }
+    });
+    return T;
 }
\ No newline at end of file
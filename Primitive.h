@@ -6,11 +6,12 @@
 #include "Material.h"
 #include "AABB.h"
 #include "Transformation.h"
+#include "DensityField.h"
 
 struct Primitive {
     static double timeStart, timeEnd;
     static bool motionBlur;
-    std::shared_ptr<Material> mat;
+    uint32_t matId{ NO_MATERIAL };  // index into MaterialTable
     Vec3 centroid;
     Vec3 velocity;
     bool moving{ false };
@@ -18,9 +19,11 @@ struct Primitive {
     Primitive() = default;
     template <typename MaterialType>
     Primitive(const MaterialType &m, Vec3 c = Vec3(), Vec3 v = Vec3()) :
-        mat(std::make_shared< MaterialType>(m)), centroid(c), velocity(v), moving(v.length()) { moving = moving && motionBlur; }
+        matId(MaterialTable::add(m)), centroid(c), velocity(v), moving(v.length()) { moving = moving && motionBlur; }
     virtual bool hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const = 0;
     virtual void makeAABB() = 0;
+    // Bounds at one instant, for the time-interpolated BVH. Only moving primitives differ from box.
+    virtual AABB boxAt(double time) const { return box; }
     virtual void printSelf() const = 0;
     virtual Vec2 uv(const Vec3 &p) const = 0;
     virtual void transform(const Transformation &trans) = 0;
@@ -51,15 +54,12 @@ struct Sphere : public Primitive {
     Sphere(double r, const MaterialType &m, Vec3 v = Vec3()) :
         Primitive(m, Vec3(), v), radius(r), center(Vec3()) {}
     bool hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const override;
-    void makeAABB() override {
-        if (!moving) box = AABB(center - Vec3(radius), center + Vec3(radius));
-        Vec3 centerT0 = center + timeStart * velocity;
-        Vec3 centerT1 = center + timeEnd * velocity;
-        AABB abT0 = AABB(centerT0 - Vec3(radius), centerT0 + Vec3(radius));
-        AABB abT1 = AABB(centerT1 - Vec3(radius), centerT1 + Vec3(radius));
-        box = abT0 + abT1;
+    void makeAABB() override { box = moving ? boxAt(timeStart) + boxAt(timeEnd) : boxAt(0.0); }
+    virtual AABB boxAt(double time) const override {
+        Vec3 centerAt{ moving ? center + time * velocity : center };
+        return AABB(centerAt - Vec3(radius), centerAt + Vec3(radius));
     }
-    virtual void printSelf() const override { std::cout << "Sphere " << typeid(*mat).name(); }
+    virtual void printSelf() const override { std::cout << "Sphere " << typeid(MaterialTable::get(matId)).name(); }
     virtual Vec2 uv(const Vec3 &p) const override {
         double phi{ atan2(p.z, p.x) };
         double theta{ asin(p.y) };
@@ -92,7 +92,7 @@ struct Triangle : public Primitive {
     }
     bool hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const override;
     void makeAABB() override { box = AABB(minVec3(minVec3(A, B), C), maxVec3(maxVec3(A, B), C)); }
-    virtual void printSelf() const override { std::cout << "Triangle " << typeid(*mat).name(); }
+    virtual void printSelf() const override { std::cout << "Triangle " << typeid(MaterialTable::get(matId)).name(); }
     virtual Vec2 uv(const Vec3 &p) const override {
         // p: Centrobaric Coordinate
         return uvA * p.x + uvB * p.y +uvC * p.z;
@@ -106,15 +106,27 @@ struct Volume : public Primitive {
     AABB volumeBoundary;
     Transformation tf, tfi, rot;
     double density{ 1.0 };
+    // Heterogeneous density in local space, nullptr for constant density.
+    std::shared_ptr<DensityField> field;
+    MajorantGrid majorants;
     
     Volume() = default;
     template <typename TextureType = ConstantTexture>
     Volume(double x, double z, double y, double d = 1.0, const TextureType &t = ConstantTexture(WHITE)) :
         Primitive(Isotropic(t)), density(d),
         volumeBoundary({ Vec3(-x * 0.5, -y * 0.5, -z * 0.5), Vec3(x * 0.5, y * 0.5, z * 0.5), 0.0 }) {}
+    template <typename TextureType = ConstantTexture>
+    Volume(double x, double z, double y, std::shared_ptr<DensityField> f, const TextureType &t = ConstantTexture(WHITE),
+        int majorantResolution = 16) :
+        Primitive(Isotropic(t)),
+        volumeBoundary({ Vec3(-x * 0.5, -y * 0.5, -z * 0.5), Vec3(x * 0.5, y * 0.5, z * 0.5), 0.0 }),
+        field(f), majorants(*f, volumeBoundary, majorantResolution) {}
+    // Shadow rays (rec.shadow) never hit a volume, Camera multiplies in transmittance() instead.
     virtual bool hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const override;
+    // Fraction of light passing between tMin and tMax. Exact for constant density, ratio tracking otherwise.
+    double transmittance(const Ray &ray, double tMin, double tMax, Sampler &sampler) const;
     virtual void makeAABB() override { box = volumeBoundary * tf; }
-    virtual void printSelf() const override { std::cout << "Volume " << typeid(*mat).name(); }
+    virtual void printSelf() const override { std::cout << "Volume " << typeid(MaterialTable::get(matId)).name(); }
     virtual Vec2 uv(const Vec3 &p) const override { return Vec2(); };
     virtual void transform(const Transformation &trans) override {
         tf = trans;
@@ -2,17 +2,20 @@
 
 #include "Vector.h"
 
-struct Ray {
-    Vec3 origin;
-    Vec3 direction;
-    Vec3 directionReciprocal;
+template <typename T>
+struct RayT {
+    Vec3T<T> origin;
+    Vec3T<T> direction;
+    Vec3T<T> directionReciprocal;
     double time{ -1.0 };
     bool xPositive{ true }, yPositive{ true }, zPositive{ true };
 
-    Ray() = default;
-    Ray(const Vec3 &o, const Vec3 &d, const double &t = -1.0) :
+    RayT() = default;
+    RayT(const Vec3T<T> &o, const Vec3T<T> &d, const double &t = -1.0) :
         origin(o), direction(d), directionReciprocal(d.reciprocal()),
         xPositive(d.x >= 0), yPositive(d.y >= 0), zPositive(d.z >= 0),
         time(t) {}
-    Vec3 pointAtT(double t) const { return origin + direction * t; }
-};
\ No newline at end of file
+    Vec3T<T> pointAtT(T t) const { return origin + direction * t; }
+};
+
+using Ray = RayT<Real>;
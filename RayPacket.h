@@ -0,0 +1,126 @@
+#pragma once
+
+#include "LinearBVH.h"
+#include "SIMD.h"
+
+template <int N>
+struct alignas(32) RayPacket {
+    /*
+        N coherent rays traced together through a LinearBVH.
+        Origins, reciprocal directions and tMax are copied into SoA float lanes
+        so one SIMD sequence tests a node box against all N rays. Primitive
+        tests stay scalar and use the double precision rays.
+    */
+    static_assert(N % 4 == 0, "RayPacket lanes come in groups of four");
+    float ox[N], oy[N], oz[N];
+    float idx[N], idy[N], idz[N];
+    float tMaxLane[N];
+    Ray rays[N];
+    HitRec recs[N];
+    double tMin{ 0.0 };
+    double tMax[N];
+    int activeMask{ 0 };  // bit i set if lane i holds a ray
+
+    RayPacket() = default;
+    void set(int lane, const Ray &ray, double rayTMax);
+    void clear() { activeMask = 0; }
+    // Bit i is set if active lane i enters the box within [tMin, tMax[i]].
+    int hit(const LinearBVHNode &node, int mask) const;
+};
+
+template <int N>
+inline void RayPacket<N>::set(int lane, const Ray &ray, double rayTMax) {
+    rays[lane] = ray;
+    ox[lane] = static_cast<float>(ray.origin.x);
+    oy[lane] = static_cast<float>(ray.origin.y);
+    oz[lane] = static_cast<float>(ray.origin.z);
+    idx[lane] = static_cast<float>(ray.directionReciprocal.x);
+    idy[lane] = static_cast<float>(ray.directionReciprocal.y);
+    idz[lane] = static_cast<float>(ray.directionReciprocal.z);
+    tMax[lane] = rayTMax;
+    tMaxLane[lane] = static_cast<float>(rayTMax);
+    activeMask |= 1 << lane;
+}
+
+template <int N>
+inline int RayPacket<N>::hit(const LinearBVHNode &node, int mask) const {
+    // Lanes may differ in direction sign, so near/far planes are sorted per lane with min/max.
+    float tMinF{ static_cast<float>(tMin) };
+    int result{ 0 };
+#if PBRT_SSE
+    const __m128 minX{ _mm_set1_ps(node.minBound[0]) }, maxX{ _mm_set1_ps(node.maxBound[0]) };
+    const __m128 minY{ _mm_set1_ps(node.minBound[1]) }, maxY{ _mm_set1_ps(node.maxBound[1]) };
+    const __m128 minZ{ _mm_set1_ps(node.minBound[2]) }, maxZ{ _mm_set1_ps(node.maxBound[2]) };
+    const __m128 laneTMin{ _mm_set1_ps(tMinF) }, roundUp{ _mm_set1_ps(1.0000004f) };
+    for (int g{ 0 }; g < N; g += 4) {
+        if (!(mask >> g & 0xf)) continue;
+        const __m128 o{ _mm_load_ps(ox + g) }, id{ _mm_load_ps(idx + g) };
+        __m128 ax{ _mm_mul_ps(_mm_sub_ps(minX, o), id) }, bx{ _mm_mul_ps(_mm_sub_ps(maxX, o), id) };
+        const __m128 oY{ _mm_load_ps(oy + g) }, idY{ _mm_load_ps(idy + g) };
+        __m128 ay{ _mm_mul_ps(_mm_sub_ps(minY, oY), idY) }, by{ _mm_mul_ps(_mm_sub_ps(maxY, oY), idY) };
+        const __m128 oZ{ _mm_load_ps(oz + g) }, idZ{ _mm_load_ps(idz + g) };
+        __m128 az{ _mm_mul_ps(_mm_sub_ps(minZ, oZ), idZ) }, bz{ _mm_mul_ps(_mm_sub_ps(maxZ, oZ), idZ) };
+        __m128 t0{ _mm_max_ps(_mm_max_ps(_mm_min_ps(ax, bx), _mm_min_ps(ay, by)),
+            _mm_max_ps(_mm_min_ps(az, bz), laneTMin)) };
+        __m128 t1{ _mm_min_ps(_mm_min_ps(_mm_max_ps(ax, bx), _mm_max_ps(ay, by)),
+            _mm_min_ps(_mm_max_ps(az, bz), _mm_load_ps(tMaxLane + g))) };
+        result |= _mm_movemask_ps(_mm_cmple_ps(t0, _mm_mul_ps(t1, roundUp))) << g;
+    }
+#else
+    for (int i{ 0 }; i < N; ++i) {
+        if (!(mask >> i & 1)) continue;
+        float ax{ (node.minBound[0] - ox[i]) * idx[i] }, bx{ (node.maxBound[0] - ox[i]) * idx[i] };
+        float ay{ (node.minBound[1] - oy[i]) * idy[i] }, by{ (node.maxBound[1] - oy[i]) * idy[i] };
+        float az{ (node.minBound[2] - oz[i]) * idz[i] }, bz{ (node.maxBound[2] - oz[i]) * idz[i] };
+        float t0{ std::max(std::max(std::min(ax, bx), std::min(ay, by)), std::max(std::min(az, bz), tMinF)) };
+        float t1{ std::min(std::min(std::max(ax, bx), std::max(ay, by)), std::min(std::max(az, bz), tMaxLane[i])) };
+        result |= (t0 <= t1 * 1.0000004f) << i;
+    }
+#endif
+    return result & mask;
+}
+
+template <int N>
+int LinearBVH::hitPacket(RayPacket<N> &packet) const {
+    // Any active lane hitting a node sends the whole packet in, the lanes that hit ride along as a mask.
+    // Near/far order follows the first active lane, the packet is assumed coherent.
+    int hitMask{ 0 };
+    if (nodes.empty() || !packet.activeMask) return hitMask;
+
+    int lead{ 0 };
+    while (!(packet.activeMask >> lead & 1)) ++lead;
+    const int dirIsNeg[3]{ !packet.rays[lead].xPositive, !packet.rays[lead].yPositive, !packet.rays[lead].zPositive };
+
+    struct Entry { int node, mask; };
+    Entry stack[64];
+    int stackSize{ 0 };
+    stack[stackSize++] = { 0, packet.activeMask };
+
+    while (stackSize) {
+        const Entry entry{ stack[--stackSize] };
+        const LinearBVHNode &node{ nodes[entry.node] };
+        int mask{ packet.hit(node, entry.mask) };
+        if (!mask) continue;
+
+        if (node.primCount) {
+            for (int lane{ 0 }; lane < N; ++lane) {
+                if (!(mask >> lane & 1)) continue;
+                for (int i{ 0 }; i < node.primCount; ++i) {
+                    if (orderedPrims[node.offset + i]->hit(
+                        packet.rays[lane], packet.tMin, packet.tMax[lane], packet.recs[lane])) {
+                        hitMask |= 1 << lane;
+                        packet.tMax[lane] = packet.recs[lane].t;
+                        packet.tMaxLane[lane] = static_cast<float>(packet.tMax[lane]);
+                    }
+                }
+            }
+        } else {
+            // Push far child first, near child is popped next.
+            int nearChild{ entry.node + 1 }, farChild{ node.offset };
+            if (dirIsNeg[node.axis]) std::swap(nearChild, farChild);
+            stack[stackSize++] = { farChild, mask };
+            stack[stackSize++] = { nearChild, mask };
+        }
+    }
+    return hitMask;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// Scalar type of geometry: Vec3, Vec2, Ray and AABB, so traversal and intersection.
+// Build with PBRT_FLOAT=1 (-DPBRT_FLOAT=1, or /DPBRT_FLOAT=1 on MSVC) to run them in float.
+// Color and Transformation stay double: sample accumulation and matrix inversion need the precision.
+#if PBRT_FLOAT
+using Real = float;
+#else
+using Real = double;
+#endif
+
+// Smallest t accepted when tracing from a surface. A float hit point is only good to about 1e-6
+// of the scene scale, so anything finer lets rays hit the surface they start from.
+#if PBRT_FLOAT
+constexpr double RAY_EPSILON{ 0.0001 };
+#else
+constexpr double RAY_EPSILON{ 0.0000001 };
+#endif
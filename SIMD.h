@@ -0,0 +1,17 @@
+#pragma once
+
+// SIMD availability. SSE2 is part of every x64 target, AVX needs /arch:AVX (MSVC) or -mavx.
+// Code using these must keep a scalar path for targets where neither is defined.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PBRT_SSE 1
+#endif
+#if defined(__AVX__)
+#define PBRT_AVX 1
+#endif
+#if defined(__AVX2__)
+#define PBRT_AVX2 1
+#endif
+
+#if PBRT_SSE || PBRT_AVX
+#include <immintrin.h>
+#endif
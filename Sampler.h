@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+
+struct Sampler {
+    /*
+        PCG32 (XSH RR variant), https://www.pcg-random.org
+        64-bit LCG state, output is a permuted 32-bit word. 16 bytes, no shared state,
+        so every render thread owns its own and never touches another's cache line.
+
+        startPixelSample() reseeds deterministically from (pixel, sample, frame):
+        the same seed gives the same image, whatever thread renders which pixel.
+    */
+    uint64_t state{ 0x853c49e6748fea9bULL };
+    uint64_t inc{ 0xda3e39cb94b95bdbULL };  // stream, always odd
+
+    Sampler() = default;
+    Sampler(uint64_t initState, uint64_t stream = 0) { seed(initState, stream); }
+
+    void seed(uint64_t initState, uint64_t stream = 0);
+    void startPixelSample(uint32_t pixel, uint32_t sampleIndex, uint32_t frame = 0, uint64_t globalSeed = 0);
+
+    uint32_t next();
+    double rand01() { return next() * (1.0 / 4294967296.0); }  // [0, 1)
+    double rand11() { return 0.0001 + 0.9999 * rand01(); }  // [0.0001, 1), safe for log()
+
+    // UniformRandomBitGenerator, so std::shuffle etc. accept a Sampler.
+    using result_type = uint32_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+    result_type operator()() { return next(); }
+};
+
+inline uint64_t splitMix64(uint64_t x) {
+    // Avalanche mixing, turns neighbouring pixel indices into unrelated seeds.
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+inline void Sampler::seed(uint64_t initState, uint64_t stream) {
+    state = 0;
+    inc = (stream << 1) | 1;
+    next();
+    state += initState;
+    next();
+}
+
+inline void Sampler::startPixelSample(uint32_t pixel, uint32_t sampleIndex, uint32_t frame, uint64_t globalSeed) {
+    seed(splitMix64(globalSeed ^ (static_cast<uint64_t>(frame) << 32 | pixel)), sampleIndex);
+}
+
+inline uint32_t Sampler::next() {
+    uint64_t old{ state };
+    state = old * 6364136223846793005ULL + inc;
+    uint32_t xorShifted{ static_cast<uint32_t>(((old >> 18) ^ old) >> 27) };
+    uint32_t rot{ static_cast<uint32_t>(old >> 59) };
+    return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+}
+
+inline Sampler &threadSampler() {
+    // For code without a sampler handed down, e.g. scene construction. Never shared between threads.
+    static thread_local Sampler sampler;
+    return sampler;
+}
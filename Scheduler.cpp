@@ -0,0 +1,96 @@
+#include "Scheduler.h"
+#include <cstdint>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+
+static uint32_t mortonCode(uint32_t x, uint32_t y) {
+    // Interleave bits: x on even bits, y on odd bits.
+    auto spread = [](uint32_t v) -> uint32_t {
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+std::vector<Tile> makeTiles(int width, int height, int tileSize, TILE_ORDER order) {
+    int tilesX{ (width + tileSize - 1) / tileSize };
+    int tilesY{ (height + tileSize - 1) / tileSize };
+
+    struct Keyed { double key; Tile tile; };
+    std::vector<Keyed> keyed;
+    keyed.reserve(tilesX * tilesY);
+    double centerX{ (tilesX - 1) * 0.5 }, centerY{ (tilesY - 1) * 0.5 };
+    for (int ty{ 0 }; ty < tilesY; ++ty) {
+        for (int tx{ 0 }; tx < tilesX; ++tx) {
+            Tile tile(tx * tileSize, ty * tileSize,
+                std::min(width, (tx + 1) * tileSize), std::min(height, (ty + 1) * tileSize));
+            double key;
+            if (order == MORTON) key = mortonCode(tx, ty);
+            else {
+                // Ring index first, then angle around the center inside the ring.
+                double dx{ tx - centerX }, dy{ ty - centerY };
+                double ring{ std::ceil(std::max(std::fabs(dx), std::fabs(dy))) };
+                key = ring * 8.0 + (std::atan2(dy, dx) + 3.141592653589793) / 3.141592653589793;
+            }
+            keyed.push_back({ key, tile });
+        }
+    }
+    std::stable_sort(keyed.begin(), keyed.end(), [](const Keyed &a, const Keyed &b) { return a.key < b.key; });
+
+    std::vector<Tile> tiles;
+    tiles.reserve(keyed.size());
+    for (const auto &k : keyed) tiles.push_back(k.tile);
+    return tiles;
+}
+
+WorkStealingPool::WorkStealingPool(int threads) {
+    threadCount = threads > 0 ? threads : static_cast<int>(std::thread::hardware_concurrency());
+    if (threadCount < 1) threadCount = 1;
+}
+
+void WorkStealingPool::run(int taskCount, const std::function<void(int, int)> &job) {
+    std::vector<WorkQueue> queues(threadCount);
+    for (int t{ 0 }; t < threadCount; ++t) {
+        int begin{ static_cast<int>(1LL * taskCount * t / threadCount) };
+        int end{ static_cast<int>(1LL * taskCount * (t + 1) / threadCount) };
+        for (int task{ begin }; task < end; ++task) queues[t].tasks.push_back(task);
+    }
+
+    auto worker = [&](int thread) {
+        int task;
+        while (pop(queues, thread, task) || steal(queues, thread, task)) job(task, thread);
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount - 1);
+    for (int t{ 1 }; t < threadCount; ++t) workers.emplace_back(worker, t);
+    worker(0);  // calling thread works too
+    for (auto &w : workers) w.join();
+}
+
+bool WorkStealingPool::pop(std::vector<WorkQueue> &queues, int thread, int &task) const {
+    WorkQueue &q{ queues[thread] };
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (q.tasks.empty()) return false;
+    task = q.tasks.front();
+    q.tasks.pop_front();
+    return true;
+}
+
+bool WorkStealingPool::steal(std::vector<WorkQueue> &queues, int thread, int &task) const {
+    // No task is ever added after run() starts, so one sweep over all victims is enough.
+    for (int i{ 1 }; i < threadCount; ++i) {
+        WorkQueue &victim{ queues[(thread + i) % threadCount] };
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.tasks.empty()) continue;
+        task = victim.tasks.back();
+        victim.tasks.pop_back();
+        return true;
+    }
+    return false;
+}
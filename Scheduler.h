@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+
+enum TILE_ORDER { MORTON, SPIRAL };
+
+struct Tile {
+    int x0{ 0 }, y0{ 0 }, x1{ 0 }, y1{ 0 };  // pixel range [x0, x1) * [y0, y1)
+    double milliseconds{ 0.0 };  // render time, filled in by the renderer
+    int thread{ -1 };  // which worker rendered it
+
+    Tile() = default;
+    Tile(int _x0, int _y0, int _x1, int _y1) : x0(_x0), y0(_y0), x1(_x1), y1(_y1) {}
+};
+
+// Split the film into tileSize * tileSize tiles (smaller at the right and bottom edges).
+// MORTON: Z-order curve, neighbouring tiles stay close in the list.
+// SPIRAL: from the film center outward, the interesting part finishes first.
+std::vector<Tile> makeTiles(int width, int height, int tileSize, TILE_ORDER order);
+
+struct WorkStealingPool {
+    /*
+        Tasks are dealt in contiguous chunks to one deque per worker, so each worker
+        starts on a coherent region of the film. A worker takes from the front of its
+        own deque; once that is empty it steals from the back of another worker's,
+        taking the tasks furthest from where the victim is working.
+    */
+    int threadCount{ 1 };
+
+    WorkStealingPool(int threads = 0);  // 0: std::thread::hardware_concurrency()
+    // Run job(task, thread) for every task in [0, taskCount), returns when all are done.
+    void run(int taskCount, const std::function<void(int, int)> &job);
+
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<int> tasks;
+    };
+    bool pop(std::vector<WorkQueue> &queues, int thread, int &task) const;
+    bool steal(std::vector<WorkQueue> &queues, int thread, int &task) const;
+};
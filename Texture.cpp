@@ -1,12 +1,59 @@
+// plainPerlin4 repeats the scalar noise operations one by one and must round the same way, so
+// neither may fuse a * b + c into an FMA (-mfma, -march=native): contraction is off in this file.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
 #include "Texture.h"
+#include <typeinfo>
+#include <type_traits>
+
+void classifyTexture(Texture &texture) {
+    if (typeid(texture) == typeid(ConstantTexture)) texture.type = CONSTANT_TEXTURE;
+    else if (typeid(texture) == typeid(PerlinNoise)) texture.type = PERLIN_TEXTURE;
+    else if (typeid(texture) == typeid(ImageTexture)) texture.type = IMAGE_TEXTURE;
+    else if (typeid(texture) == typeid(TiledImageTexture)) texture.type = TILED_IMAGE_TEXTURE;
+    else if (typeid(texture) == typeid(CheckerTexture)) {
+        texture.type = CHECKER_TEXTURE;
+        auto &checker{ static_cast<CheckerTexture &>(texture) };
+        classifyTexture(*checker.odd);
+        classifyTexture(*checker.even);
+    } else if (typeid(texture) == typeid(MarbleNoise)) {
+        texture.type = MARBLE_TEXTURE;
+        classifyTexture(*static_cast<MarbleNoise &>(texture).noise);
+    } else texture.type = OTHER_TEXTURE;
+}
+
+void PerlinNoise::precompute() {
+    // λ https://zhuanlan.zhihu.com/p/340929847
+    for (int h{ 0 }; h < 256; ++h) {
+        float phi = raws[h] * 2.0 * PI;
+        float theta = acos(1.0 - 2 * raws[h]);
+        cosPhi[h] = cos(phi);
+        sinPhi[h] = sin(phi);
+        cosTheta[h] = cos(theta);
+        sinTheta[h] = sin(theta);
+    }
+    octaveWeights.resize(octaves + 1);
+    for (int i{ 0 }; i <= octaves; ++i) octaveWeights[i] = pow(roughness, i);
+}
 
 Color PerlinNoise::v(const Vec2 &uv, const Vec3 &p) const {
     Vec3 P{ (p + offset) * scale };
 
-    // Fractal, or turbulence
-    double color{ plainPerlin(P) };
-    for (int i = 1; i <= octaves; ++i) {
-        color += pow(roughness, i) * plainPerlin(P * lacunarity * i);
+    // Fractal, or turbulence. Octave i samples P * lacunarity * i, 4 octaves per plainPerlin batch.
+    double color{ 0.0 };
+    Vec3 points[4];
+    double noise[4];
+    for (int first{ 0 }; first <= octaves; first += 4) {
+        int count{ std::min(4, octaves + 1 - first) };
+        for (int k{ 0 }; k < count; ++k) points[k] = first + k ? P * lacunarity * (first + k) : P;
+        plainPerlin(points, noise, count);
+        for (int k{ 0 }; k < count; ++k) {
+            if (first + k) color += octaveWeights[first + k] * noise[k];
+            else color = noise[k];
+        }
     }
 
     // Fit to [-1, 1]
@@ -53,14 +100,15 @@ double PerlinNoise::plainPerlin(const Vec3 &p) const {
     Vec3 H{ A + Vec3(0.0, 1.0, 1.0) };
 
     // dotX = XP * gradiant
-    double dotA{ (p - A) * randomGradiant(A) };
-    double dotB{ (p - B) * randomGradiant(B) };
-    double dotC{ (p - C) * randomGradiant(C) };
-    double dotD{ (p - D) * randomGradiant(D) };
-    double dotE{ (p - E) * randomGradiant(E) };
-    double dotF{ (p - F) * randomGradiant(F) };
-    double dotG{ (p - G) * randomGradiant(G) };
-    double dotH{ (p - H) * randomGradiant(H) };
+    int x{ static_cast<int>(A.x) }, y{ static_cast<int>(A.y) }, z{ static_cast<int>(A.z) };
+    double dotA{ (p - A) * randomGradiant(x, y, z) };
+    double dotB{ (p - B) * randomGradiant(x + 1, y, z) };
+    double dotC{ (p - C) * randomGradiant(x + 1, y, z + 1) };
+    double dotD{ (p - D) * randomGradiant(x, y, z + 1) };
+    double dotE{ (p - E) * randomGradiant(x, y + 1, z) };
+    double dotF{ (p - F) * randomGradiant(x + 1, y + 1, z) };
+    double dotG{ (p - G) * randomGradiant(x + 1, y + 1, z + 1) };
+    double dotH{ (p - H) * randomGradiant(x, y + 1, z + 1) };
 
     // lattice uvw
     double ul{ p.x - A.x }, vl{ p.y - A.y }, wl{ p.z - A.z };
@@ -75,4 +123,155 @@ double PerlinNoise::plainPerlin(const Vec3 &p) const {
 
     // final : [-sqrt(2)/2, -sqrt(2)/2], fit to [-1, 1]
     return final * 1.414;
-}
\ No newline at end of file
+}
+
+void PerlinNoise::plainPerlin(const Vec3 *points, double *noise, int count) const {
+    int i{ 0 };
+#if PBRT_AVX2 && !PBRT_FLOAT
+    for (; i + 4 <= count; i += 4) plainPerlin4(points + i, noise + i);
+#endif
+    for (; i < count; ++i) noise[i] = plainPerlin(points[i]);
+}
+
+#if PBRT_AVX2 && !PBRT_FLOAT
+// Gradients of 4 lattice points from the PerlinNoise tables, multiplied in the tables' own precision.
+// Gathers get an explicit zero source, the unmasked form makes GCC warn that its source is uninitialized.
+template <typename Trig>
+static void gradient4(const Trig *sinTheta, const Trig *cosTheta, const Trig *sinPhi, const Trig *cosPhi,
+    __m128i phi, __m128i theta, __m256d &gx, __m256d &gy, __m256d &gz) {
+    if constexpr (std::is_same<Trig, float>::value) {
+        const __m128 all{ _mm_castsi128_ps(_mm_set1_epi32(-1)) };
+        auto gather = [&](const float *table, __m128i i) { return _mm_mask_i32gather_ps(_mm_setzero_ps(), table, i, all, 4); };
+        __m128 sinT{ gather(sinTheta, theta) };
+        gx = _mm256_cvtps_pd(_mm_mul_ps(sinT, gather(cosPhi, phi)));
+        gy = _mm256_cvtps_pd(gather(cosTheta, theta));
+        gz = _mm256_cvtps_pd(_mm_mul_ps(sinT, gather(sinPhi, phi)));
+    } else {
+        const __m256d all{ _mm256_castsi256_pd(_mm256_set1_epi64x(-1)) };
+        auto gather = [&](const double *table, __m128i i) { return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), table, i, all, 8); };
+        __m256d sinT{ gather(sinTheta, theta) };
+        gx = _mm256_mul_pd(sinT, gather(cosPhi, phi));
+        gy = gather(cosTheta, theta);
+        gz = _mm256_mul_pd(sinT, gather(sinPhi, phi));
+    }
+}
+
+void PerlinNoise::plainPerlin4(const Vec3 *points, double *noise) const {
+    /*
+        plainPerlin of 4 points, one per lane. Every lane runs the same double operations
+        in the same order as the scalar code, so results are bit for bit the same, with or
+        without FMA since contraction is off in this file. Lattice
+        hashes come from 8 gathers of permutation entries shared by the corners.
+    */
+    __m256d px{ _mm256_set_pd(points[3].x, points[2].x, points[1].x, points[0].x) };
+    __m256d py{ _mm256_set_pd(points[3].y, points[2].y, points[1].y, points[0].y) };
+    __m256d pz{ _mm256_set_pd(points[3].z, points[2].z, points[1].z, points[0].z) };
+    __m256d ax{ _mm256_floor_pd(px) }, ay{ _mm256_floor_pd(py) }, az{ _mm256_floor_pd(pz) };
+    __m128i x{ _mm256_cvttpd_epi32(ax) }, y{ _mm256_cvttpd_epi32(ay) }, z{ _mm256_cvttpd_epi32(az) };
+
+    const __m128i mask{ _mm_set1_epi32(0xFF) }, one{ _mm_set1_epi32(1) }, ten{ _mm_set1_epi32(10) };
+    auto permutation = [&](const std::array<int, 256> &table, __m128i i) {
+        return _mm_i32gather_epi32(table.data(), _mm_and_si128(i, mask), 4);
+    };
+    // [0]: lattice coordinate, [1]: the one after it. thetaX for the theta hash at x + 10.
+    __m128i hashX[2]{ permutation(permutationX, x), permutation(permutationX, _mm_add_epi32(x, one)) };
+    __m128i thetaX[2]{ permutation(permutationX, _mm_add_epi32(x, ten)),
+        permutation(permutationX, _mm_add_epi32(_mm_add_epi32(x, one), ten)) };
+    __m128i hashY[2]{ permutation(permutationY, y), permutation(permutationY, _mm_add_epi32(y, one)) };
+    __m128i hashZ[2]{ permutation(permutationZ, z), permutation(permutationZ, _mm_add_epi32(z, one)) };
+
+    // p minus the corner coordinate, corner A as is, every other corner as A + 0 or A + 1 like the scalar code.
+    const __m256d zero{ _mm256_setzero_pd() }, unit{ _mm256_set1_pd(1.0) };
+    __m256d offsetA[3]{ _mm256_sub_pd(px, ax), _mm256_sub_pd(py, ay), _mm256_sub_pd(pz, az) };
+    __m256d offsetX[2]{ _mm256_sub_pd(px, _mm256_add_pd(ax, zero)), _mm256_sub_pd(px, _mm256_add_pd(ax, unit)) };
+    __m256d offsetY[2]{ _mm256_sub_pd(py, _mm256_add_pd(ay, zero)), _mm256_sub_pd(py, _mm256_add_pd(ay, unit)) };
+    __m256d offsetZ[2]{ _mm256_sub_pd(pz, _mm256_add_pd(az, zero)), _mm256_sub_pd(pz, _mm256_add_pd(az, unit)) };
+
+    auto dot = [&](int cx, int cy, int cz, bool cornerA) {
+        __m128i yz{ _mm_xor_si128(hashY[cy], hashZ[cz]) };
+        __m128i phi{ _mm_xor_si128(hashX[cx], yz) }, theta{ _mm_xor_si128(thetaX[cx], yz) };
+        __m256d gx, gy, gz;
+        gradient4(sinTheta.data(), cosTheta.data(), sinPhi.data(), cosPhi.data(), phi, theta, gx, gy, gz);
+        __m256d dx{ cornerA ? offsetA[0] : offsetX[cx] };
+        __m256d dy{ cornerA ? offsetA[1] : offsetY[cy] };
+        __m256d dz{ cornerA ? offsetA[2] : offsetZ[cz] };
+        return _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, gx), _mm256_mul_pd(dy, gy)), _mm256_mul_pd(dz, gz));
+    };
+    auto smoothstep4 = [](__m256d a0, __m256d a1, __m256d w) {
+        __m256d t{ _mm256_add_pd(_mm256_mul_pd(w, _mm256_sub_pd(_mm256_mul_pd(w, _mm256_set1_pd(6.0)), _mm256_set1_pd(15.0))),
+            _mm256_set1_pd(10.0)) };
+        t = _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(t, w), w), w);
+        return _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(a1, a0), t), a0);
+    };
+
+    __m256d dotA{ dot(0, 0, 0, true) }, dotB{ dot(1, 0, 0, false) }, dotC{ dot(1, 0, 1, false) }, dotD{ dot(0, 0, 1, false) };
+    __m256d dotE{ dot(0, 1, 0, false) }, dotF{ dot(1, 1, 0, false) }, dotG{ dot(1, 1, 1, false) }, dotH{ dot(0, 1, 1, false) };
+    __m256d ul{ offsetA[0] }, vl{ offsetA[1] }, wl{ offsetA[2] };
+
+    __m256d interpolatedYA{ smoothstep4(dotA, dotE, vl) };
+    __m256d interpolatedYB{ smoothstep4(dotB, dotF, vl) };
+    __m256d interpolatedYC{ smoothstep4(dotC, dotG, vl) };
+    __m256d interpolatedYD{ smoothstep4(dotD, dotH, vl) };
+    __m256d interpolatedZAD{ smoothstep4(interpolatedYA, interpolatedYD, wl) };
+    __m256d interpolatedZBC{ smoothstep4(interpolatedYB, interpolatedYC, wl) };
+    __m256d final{ smoothstep4(interpolatedZAD, interpolatedZBC, ul) };
+    _mm256_storeu_pd(noise, _mm256_mul_pd(final, _mm256_set1_pd(1.414)));
+}
+#endif
+
+ImageTexture::ImageTexture(const std::string &filename) {
+    std::vector<uint8_t> rgb;
+    inputQOI(filename, width, height, rgb);
+    buildMipmaps(rgb);
+}
+
+ImageTexture::ImageTexture(int w, int h, const std::vector<uint8_t> &rgb) : width(w), height(h) {
+    if (w <= 0 || h <= 0 || rgb.size() < static_cast<size_t>(w) * h * 3) throw "Image texture data does not match its size.";
+    buildMipmaps(rgb);
+}
+
+void ImageTexture::buildMipmaps(const std::vector<uint8_t> &rgb) {
+    levels.assign(1, MipLevel{ width, height, 0 });
+    size_t bytes{ static_cast<size_t>(width) * height * 3 };
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        MipLevel coarse{ std::max(levels.back().width / 2, 1), std::max(levels.back().height / 2, 1), bytes };
+        bytes += static_cast<size_t>(coarse.width) * coarse.height * 3;
+        levels.push_back(coarse);
+    }
+    texels.resize(bytes);
+    std::copy(rgb.begin(), rgb.begin() + levels[0].width * levels[0].height * 3, texels.begin());
+
+    // 2 * 2 box filter, an odd last row or column is averaged with its neighbour clamped to the edge.
+    for (int level{ 1 }; level < static_cast<int>(levels.size()); ++level) {
+        const MipLevel &fine{ levels[level - 1] }, &coarse{ levels[level] };
+        for (int y{ 0 }; y < coarse.height; ++y) {
+            int y0{ std::min(y * 2, fine.height - 1) }, y1{ std::min(y * 2 + 1, fine.height - 1) };
+            for (int x{ 0 }; x < coarse.width; ++x) {
+                int x0{ std::min(x * 2, fine.width - 1) }, x1{ std::min(x * 2 + 1, fine.width - 1) };
+                const uint8_t *a{ texel(level - 1, x0, y0) }, *b{ texel(level - 1, x1, y0) };
+                const uint8_t *c{ texel(level - 1, x0, y1) }, *d{ texel(level - 1, x1, y1) };
+                uint8_t *dst{ &texels[coarse.offset + (static_cast<size_t>(y) * coarse.width + x) * 3] };
+                for (int ch{ 0 }; ch < 3; ++ch) dst[ch] = static_cast<uint8_t>((a[ch] + b[ch] + c[ch] + d[ch] + 2) / 4);
+            }
+        }
+    }
+}
+
+Color TiledImageTexture::bilinear(int level, const Vec2 &uv) const {
+    // The 4 texels may fall into up to 4 tiles, all held until the filter has read them.
+    const TiledTextureInfo::Level &l{ info.levels[level] };
+    TextureCache::TilePointer tiles[4];
+    int tileX[4], tileY[4], tileCount{ 0 };
+    return bilinearRGB8(l.width, l.height, uv, [&](int x, int y) {
+        int tx{ x / info.tileSize }, ty{ y / info.tileSize };
+        int t{ 0 };
+        while (t < tileCount && (tileX[t] != tx || tileY[t] != ty)) ++t;
+        if (t == tileCount) {
+            tiles[t] = cache->tile(file, level, tx, ty);
+            tileX[t] = tx;
+            tileY[t] = ty;
+            ++tileCount;
+        }
+        return &(*tiles[t])[(static_cast<size_t>(y % info.tileSize) * info.tileSize + x % info.tileSize) * 3];
+    });
+}
@@ -4,16 +4,29 @@
 #include "Color.h"
 #include "utility.h"
 #include "imageIO.h"
+#include "TextureCache.h"
+#include "SIMD.h"
 #include <algorithm>
 
+// Built-in texture types, dispatched with a switch by textureValue. OTHER_TEXTURE keeps the virtual v.
+enum TEXTURE_TYPE {
+    CONSTANT_TEXTURE, CHECKER_TEXTURE, PERLIN_TEXTURE, MARBLE_TEXTURE, IMAGE_TEXTURE, TILED_IMAGE_TEXTURE, OTHER_TEXTURE
+};
+
 struct Texture {
     double scale{ 1.0 };
     Vec3 offset;
+    TEXTURE_TYPE type{ OTHER_TEXTURE };  // set by classifyTexture from the exact type
     Texture() = default;
     Texture(double s, Vec3 o = Vec3()) : scale(1.0 / s) , offset(o) {}
     virtual Color v(const Vec2 &uv, const Vec3 &p) const = 0;  // value
 };
 
+// Tags texture and the textures it is built from with their exact type. A subclass stays OTHER_TEXTURE.
+void classifyTexture(Texture &texture);
+// Same as texture.v(uv, p), with the built-in types called directly so the common ones inline.
+inline Color textureValue(const Texture &texture, const Vec2 &uv, const Vec3 &p);
+
 struct ConstantTexture : public Texture {
     Color albedo;
 
@@ -32,8 +45,8 @@ struct CheckerTexture : public Texture {
         int xOdd{ static_cast<int>(ceil((p.x + 0.01) * scale)) & 1 };
         int yOdd{ static_cast<int>(ceil((p.y + 0.01) * scale)) & 1 };
         int zOdd{ static_cast<int>(ceil((p.z + 0.01) * scale)) & 1 };
-        if (xOdd ^ yOdd ^ zOdd) return odd->v(uv, p);
-        else return even->v(uv, p);
+        if (xOdd ^ yOdd ^ zOdd) return textureValue(*odd, uv, p);
+        else return textureValue(*even, uv, p);
     }
 };
 
@@ -51,48 +64,54 @@ struct PerlinNoise : public Texture {
     double normalizeFactor{ 0.0 };
     bool fold{ false };
 
-    PerlinNoise() = default;
-    PerlinNoise(double s, bool f = false, int o = 0, double l = 2.0, double r = 0.5, Vec3 offset = Vec3()) :
+    PerlinNoise() { precompute(); }
+    PerlinNoise(double s, bool f = false, int o = 0, double l = 2.0, double r = 0.5, Vec3 offset = Vec3(),
+        Sampler &sampler = threadSampler()) :
         Texture(s, offset), octaves(o), lacunarity(l), roughness(r), fold(f) {
         normalizeFactor = (1.0 - roughness) / (1.0 - pow(roughness, octaves + 1.0));
 
-        // URGB: Uniform Random Bit Generator
-        static std::default_random_engine URGB1(1), URGB2(2), URGB3(3);
+        // Lattice values and permutations all come from the given sampler, so a seed fixes the noise.
         for (int i{ 0 }; i < 256; ++i) {
-            raws[i] = rand01();
+            raws[i] = sampler.rand01();
             permutationX[i] = i;
             permutationY[i] = i;
             permutationZ[i] = i;
         }
-        std::shuffle(permutationX.begin(), permutationX.end(), URGB1);
-        std::shuffle(permutationY.begin(), permutationY.end(), URGB2);
-        std::shuffle(permutationZ.begin(), permutationZ.end(), URGB3);
+        std::shuffle(permutationX.begin(), permutationX.end(), sampler);
+        std::shuffle(permutationY.begin(), permutationY.end(), sampler);
+        std::shuffle(permutationZ.begin(), permutationZ.end(), sampler);
+        precompute();
     }
     virtual Color v(const Vec2 &uv, const Vec3 &p) const override;
+    // plainPerlin of count points, 4 at a time with AVX2.
+    void plainPerlin(const Vec3 *points, double *noise, int count) const;
 
 private:
-    Vec3 randomGradiant(const Vec3 &p) const;
-    double randomDouble(const Vec3 &p) const;
+    /*
+        Lookup tables, filled by precompute from the lattice values and roughness above.
+        A lattice gradient is built from the sin and cos of two angles, each taken from one
+        raws entry, so the 4 functions of the 256 possible angles cover every gradient.
+        Trig is whatever sin(float) returns: the products are then rounded as before.
+    */
+    using Trig = decltype(sin(float()));
+    std::array<Trig, 256> cosPhi{}, sinPhi{}, cosTheta{}, sinTheta{};
+    std::vector<double> octaveWeights;  // pow(roughness, i)
+
+    void precompute();
+    Vec3 randomGradiant(int x, int y, int z) const;
     double plainPerlin(const Vec3 &p) const;
+#if PBRT_AVX2 && !PBRT_FLOAT
+    void plainPerlin4(const Vec3 *points, double *noise) const;
+#endif
     double smoothstep(double a0, double a1, double w) const;
 };
 
-inline double PerlinNoise::randomDouble(const Vec3 &p) const {
-    return raws[
-        permutationX[static_cast<int>(p.x) & 0xFF] ^
-        permutationY[static_cast<int>(p.y) & 0xFF] ^
-        permutationZ[static_cast<int>(p.z) & 0xFF]
-    ];
-}
-
-inline Vec3 PerlinNoise::randomGradiant(const Vec3 &p) const {
-    // λ https://zhuanlan.zhihu.com/p/340929847
-    Vec3 flooredP{ p.vecFloor() };
-    float phi = randomDouble(flooredP) * 2.0 * PI;
-
-    flooredP.x += 10;
-    float theta = acos(1.0 - 2 * randomDouble(flooredP));
-    return Vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+inline Vec3 PerlinNoise::randomGradiant(int x, int y, int z) const {
+    // Gradient of lattice point (x, y, z): phi from its hash, theta from the hash of (x + 10, y, z).
+    int hashYZ{ permutationY[y & 0xFF] ^ permutationZ[z & 0xFF] };
+    int phi{ permutationX[x & 0xFF] ^ hashYZ };
+    int theta{ permutationX[(x + 10) & 0xFF] ^ hashYZ };
+    return Vec3(sinTheta[theta] * cosPhi[phi], cosTheta[theta], sinTheta[theta] * sinPhi[phi]);
 }
 
 inline double PerlinNoise::smoothstep(double a0, double a1, double w) const {
@@ -110,22 +129,108 @@ struct MarbleNoise : public Texture {
     MarbleNoise(double a, std::shared_ptr<Texture> n, double s = 1.0, Vec3 offset = Vec3()) :
         Texture(s, offset), amplitude(a), noise(n) {}
     virtual Color v(const Vec2 &uv, const Vec3 &p) const override {
-        return Color(sin(scale * p.z + amplitude * noise->v(uv, p).R) * 0.5 + 0.5);
+        return Color(sin(scale * p.z + amplitude * textureValue(*noise, uv, p).R) * 0.5 + 0.5);
     }
 };
 
+// Bilinear filter over an 8-bit RGB image, texel(x, y) returns the bytes of one texel.
+// uv outside [0, 1] clamps to the edge texels.
+template <typename TexelFunction>
+Color bilinearRGB8(int width, int height, const Vec2 &uv, TexelFunction &&texel) {
+    double x{ uv.u * width - 0.5 }, y{ uv.v * height - 0.5 };
+    double floorX{ std::floor(x) }, floorY{ std::floor(y) };
+    double tx{ x - floorX }, ty{ y - floorY };
+    int x0{ static_cast<int>(std::max(std::min(floorX, width - 1.0), 0.0)) };
+    int y0{ static_cast<int>(std::max(std::min(floorY, height - 1.0), 0.0)) };
+    int x1{ static_cast<int>(std::max(std::min(floorX + 1.0, width - 1.0), 0.0)) };
+    int y1{ static_cast<int>(std::max(std::min(floorY + 1.0, height - 1.0), 0.0)) };
+
+    const uint8_t *a{ texel(x0, y0) }, *b{ texel(x1, y0) };
+    const uint8_t *c{ texel(x0, y1) }, *d{ texel(x1, y1) };
+    double wa{ (1.0 - tx) * (1.0 - ty) }, wb{ tx * (1.0 - ty) }, wc{ (1.0 - tx) * ty }, wd{ tx * ty };
+    auto channel = [&](int ch) { return (a[ch] * wa + b[ch] * wb + c[ch] * wc + d[ch] * wd) / 255.99; };
+    return Color(channel(0), channel(1), channel(2));
+}
+
+// Trilinear: bilinear(level, uv) on the two mip levels around a footprint of the given size,
+// 1.0 being the whole image of size texels.
+template <typename BilinearFunction>
+Color trilinearRGB8(int size, int levelCount, const Vec2 &uv, double footprint, BilinearFunction &&bilinear) {
+    double texelCount{ footprint * size };
+    if (texelCount <= 1.0) return bilinear(0, uv);
+    double lod{ std::min(std::log2(texelCount), levelCount - 1.0) };
+    int fine{ static_cast<int>(lod) };
+    if (fine + 1 >= levelCount) return bilinear(fine, uv);
+    double t{ lod - fine };
+    return bilinear(fine, uv) * (1.0 - t) + bilinear(fine + 1, uv) * t;
+}
+
 struct ImageTexture : public Texture {
-    // QOI image
+    /*
+        QOI image kept as its 8-bit RGB bytes, read back as byte / 255.99 like inputQOI does.
+        The whole mip pyramid sits row by row in one buffer. Level 0 is the image, each further
+        level halves the one before with a box filter, down to 1 * 1.
+    */
+    struct MipLevel {
+        int width{ 0 }, height{ 0 };
+        size_t offset{ 0 };  // of texel (0, 0) in texels
+    };
     int width{ 0 }, height{ 0 };
-    std::vector<std::vector<Color>> pixelData;
+    std::vector<MipLevel> levels;
+    std::vector<uint8_t> texels;
 
     ImageTexture() = default;
-    ImageTexture(const std::string &filename) {
-        inputQOI(filename, pixelData);
-        width = pixelData[0].size();
-        height = pixelData.size();
+    ImageTexture(const std::string &filename);
+    ImageTexture(int w, int h, const std::vector<uint8_t> &rgb);  // rows top to bottom
+    // Bilinear on level 0: hits carry no footprint to pick a level from.
+    virtual Color v(const Vec2 &uv, const Vec3 &p) const override { return bilinear(0, uv); }
+    // Trilinear between the two levels around a footprint of the given size, 1.0 being the whole image.
+    Color lookup(const Vec2 &uv, double footprint) const {
+        return trilinearRGB8(std::max(width, height), static_cast<int>(levels.size()), uv, footprint,
+            [this](int level, const Vec2 &at) { return bilinear(level, at); });
     }
-    virtual Color v(const Vec2 &uv, const Vec3 &p) const override {
-        return pixelData[uv.v * height][uv.u * width];
+    Color bilinear(int level, const Vec2 &uv) const {
+        return bilinearRGB8(levels[level].width, levels[level].height, uv,
+            [this, level](int x, int y) { return texel(level, x, y); });
+    }
+    const uint8_t *texel(int level, int x, int y) const {
+        const MipLevel &l{ levels[level] };
+        return &texels[l.offset + (static_cast<size_t>(y) * l.width + x) * 3];
+    }
+    size_t memoryBytes() const { return sizeof(ImageTexture) + levels.capacity() * sizeof(MipLevel) + texels.capacity(); }
+
+private:
+    void buildMipmaps(const std::vector<uint8_t> &rgb);
+};
+
+struct TiledImageTexture : public Texture {
+    /*
+        ImageTexture read from a tiled texture file (writeTiledTexture) through a TextureCache:
+        construction only reads the header, tiles are loaded when a lookup first touches them
+        and may be evicted again, so memory stays within the cache budget. Same lookups.
+    */
+    TextureCache *cache{ nullptr };
+    int file{ -1 };
+    TiledTextureInfo info;
+
+    TiledImageTexture() = default;
+    TiledImageTexture(const std::string &filename, TextureCache &c = textureCache()) : cache(&c) { file = c.open(filename, info); }
+    virtual Color v(const Vec2 &uv, const Vec3 &p) const override { return bilinear(0, uv); }
+    Color lookup(const Vec2 &uv, double footprint) const {
+        return trilinearRGB8(std::max(info.width, info.height), static_cast<int>(info.levels.size()), uv, footprint,
+            [this](int level, const Vec2 &at) { return bilinear(level, at); });
     }
+    Color bilinear(int level, const Vec2 &uv) const;
 };
+
+inline Color textureValue(const Texture &texture, const Vec2 &uv, const Vec3 &p) {
+    switch (texture.type) {
+    case CONSTANT_TEXTURE: return static_cast<const ConstantTexture &>(texture).albedo;
+    case CHECKER_TEXTURE: return static_cast<const CheckerTexture &>(texture).CheckerTexture::v(uv, p);
+    case PERLIN_TEXTURE: return static_cast<const PerlinNoise &>(texture).PerlinNoise::v(uv, p);
+    case MARBLE_TEXTURE: return static_cast<const MarbleNoise &>(texture).MarbleNoise::v(uv, p);
+    case IMAGE_TEXTURE: return static_cast<const ImageTexture &>(texture).ImageTexture::v(uv, p);
+    case TILED_IMAGE_TEXTURE: return static_cast<const TiledImageTexture &>(texture).TiledImageTexture::v(uv, p);
+    default: return texture.v(uv, p);
+    }
+}
@@ -0,0 +1,209 @@
+#include "TextureCache.h"
+#include "Texture.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+static const char TILED_MAGIC[4]{ 'P', 'B', 'T', 'X' };
+static const uint32_t TILED_VERSION{ 1 };
+
+static uint64_t tileKey(int file, int level, int tileX, int tileY) {
+    // 16 bits file, 8 bits level, 20 bits per tile coordinate.
+    return static_cast<uint64_t>(file) << 48 | static_cast<uint64_t>(level) << 40 |
+        static_cast<uint64_t>(tileY) << 20 | static_cast<uint64_t>(tileX);
+}
+
+static int shardOf(uint64_t key) {
+    // Fibonacci hashing, neighbouring tiles land in different shards.
+    return static_cast<int>((key * 0x9E3779B97F4A7C15ull) >> 60);
+}
+
+static uint32_t readUint32(std::ifstream &in) {
+    uint32_t value{ 0 };
+    in.read(reinterpret_cast<char *>(&value), sizeof(value));
+    return value;
+}
+
+static void writeUint32(std::ofstream &out, uint32_t value) { out.write(reinterpret_cast<const char *>(&value), sizeof(value)); }
+
+int TextureCache::open(const std::string &filename, TiledTextureInfo &info) {
+    auto f{ std::make_unique<File>() };
+    f->stream.open(filename + ".tiled", std::ios::binary);
+    char magic[4]{};
+    f->stream.read(magic, 4);
+    if (!f->stream || std::memcmp(magic, TILED_MAGIC, 4) != 0) throw "Not a tiled texture file.";
+    if (readUint32(f->stream) != TILED_VERSION) throw "Unsupported tiled texture version.";
+
+    info.width = readUint32(f->stream);
+    info.height = readUint32(f->stream);
+    info.tileSize = readUint32(f->stream);
+    info.levels.resize(readUint32(f->stream));
+    for (auto &level : info.levels) {
+        level.width = readUint32(f->stream);
+        level.height = readUint32(f->stream);
+        level.tilesX = readUint32(f->stream);
+        level.tilesY = readUint32(f->stream);
+        f->stream.read(reinterpret_cast<char *>(&level.offset), sizeof(level.offset));
+    }
+    if (!f->stream || info.levels.empty() || info.levels.size() > 256 || info.tileSize <= 0) throw "Broken tiled texture header.";
+    f->info = info;
+
+    std::lock_guard<std::mutex> lock(filesMutex);
+    if (files.size() >= (size_t(1) << 16)) throw "Too many tiled texture files.";
+    files.push_back(std::move(f));
+    return static_cast<int>(files.size() - 1);
+}
+
+TextureCache::File &TextureCache::file(int id) const {
+    std::lock_guard<std::mutex> lock(filesMutex);
+    return *files[id];
+}
+
+std::atomic<uint64_t> TextureCache::instances{ 0 };
+
+TextureCache::TilePointer TextureCache::tile(int file, int level, int tileX, int tileY) {
+    uint64_t key{ tileKey(file, level, tileX, tileY) };
+    static thread_local Recent recent[RECENT];
+    Recent &r{ recent[(key * 0x9E3779B97F4A7C15ull) >> 61] };
+    if (r.cache == serial && r.key == key && r.tile) {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        // Load first: hot tiles keep their bit, and their cache line is not written on every hit.
+        if (!r.tile->referenced.load(std::memory_order_relaxed)) r.tile->referenced.store(true, std::memory_order_relaxed);
+    } else {
+        r.cache = serial;
+        r.key = key;
+        r.tile = shared(key, file, level, tileX, tileY);
+    }
+    return TilePointer(r.tile, &r.tile->texels);
+}
+
+TextureCache::TileHandle TextureCache::shared(uint64_t key, int file, int level, int tileX, int tileY) {
+    Shard &shard{ shards[shardOf(key)] };
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto found{ shard.slotOf.find(key) };
+        if (found != shard.slotOf.end()) {
+            Slot &slot{ shard.slots[found->second] };
+            slot.tile->referenced.store(true, std::memory_order_relaxed);
+            ++hits;
+            return slot.tile;
+        }
+    }
+
+    ++misses;
+    TileHandle loaded{ load(file, level, tileX, tileY) };
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found{ shard.slotOf.find(key) };
+    if (found != shard.slotOf.end()) return shard.slots[found->second].tile;  // another thread was faster
+
+    // Every shard keeps at least the tile just loaded, however small the budget.
+    size_t shardBudget{ budgetBytes / SHARDS };
+    while (!shard.slots.empty() && shard.bytes + loaded->texels.size() > shardBudget) evictOne(shard);
+    shard.slotOf[key] = shard.slots.size();
+    shard.slots.push_back(Slot{ key, loaded });
+    shard.bytes += loaded->texels.size();
+    residentBytes += loaded->texels.size();
+    return loaded;
+}
+
+TextureCache::TileHandle TextureCache::load(int id, int level, int tileX, int tileY) {
+    File &f{ file(id) };
+    const TiledTextureInfo::Level &l{ f.info.levels[level] };
+    size_t tileBytes{ f.info.tileBytes() };
+    auto loaded{ std::make_shared<Tile>() };
+    loaded->texels.resize(tileBytes);
+
+    std::lock_guard<std::mutex> lock(f.mutex);
+    f.stream.seekg(l.offset + (static_cast<uint64_t>(tileY) * l.tilesX + tileX) * tileBytes);
+    f.stream.read(reinterpret_cast<char *>(loaded->texels.data()), tileBytes);
+    if (!f.stream) throw "Cannot read texture tile.";
+    return loaded;
+}
+
+void TextureCache::evictOne(Shard &shard) {
+    // Clock: a referenced slot loses its bit and gets another round, the first one without goes.
+    for (;;) {
+        if (shard.hand >= shard.slots.size()) shard.hand = 0;
+        Slot &slot{ shard.slots[shard.hand] };
+        if (slot.tile->referenced.load(std::memory_order_relaxed)) {
+            slot.tile->referenced.store(false, std::memory_order_relaxed);
+            ++shard.hand;
+            continue;
+        }
+        shard.bytes -= slot.tile->texels.size();
+        residentBytes -= slot.tile->texels.size();
+        ++evictions;
+        shard.slotOf.erase(slot.key);
+        if (shard.hand + 1 != shard.slots.size()) {
+            slot = std::move(shard.slots.back());
+            shard.slotOf[slot.key] = shard.hand;
+        }
+        shard.slots.pop_back();
+        return;
+    }
+}
+
+TextureCacheStats TextureCache::stats() const {
+    TextureCacheStats s;
+    s.hits = hits;
+    s.misses = misses;
+    s.evictions = evictions;
+    s.residentBytes = residentBytes;
+    s.budgetBytes = budgetBytes;
+    std::lock_guard<std::mutex> lock(filesMutex);
+    s.files = static_cast<int>(files.size());
+    return s;
+}
+
+void TextureCacheStats::print() const {
+    std::cout << "Texture cache: " << files << " files, hit rate " << hitRate() * 100.0 << "% ("
+        << hits << " hits, " << misses << " misses), " << evictions << " evictions, resident "
+        << residentBytes / 1048576.0 << " of " << budgetBytes / 1048576.0 << " MB" << std::endl;
+}
+
+TextureCache &textureCache() {
+    static TextureCache cache;
+    return cache;
+}
+
+void writeTiledTexture(const std::string &filename, const ImageTexture &image, int tileSize) {
+    std::ofstream out(filename + ".tiled", std::ios::binary);
+    if (!out) throw "Cannot write tiled texture file.";
+    out.write(TILED_MAGIC, 4);
+    writeUint32(out, TILED_VERSION);
+    writeUint32(out, image.width);
+    writeUint32(out, image.height);
+    writeUint32(out, tileSize);
+    writeUint32(out, static_cast<uint32_t>(image.levels.size()));
+
+    size_t tileBytes{ static_cast<size_t>(tileSize) * tileSize * 3 };
+    uint64_t offset{ 6 * sizeof(uint32_t) + image.levels.size() * (4 * sizeof(uint32_t) + sizeof(uint64_t)) };
+    for (const auto &level : image.levels) {
+        uint32_t tilesX{ static_cast<uint32_t>((level.width + tileSize - 1) / tileSize) };
+        uint32_t tilesY{ static_cast<uint32_t>((level.height + tileSize - 1) / tileSize) };
+        writeUint32(out, level.width);
+        writeUint32(out, level.height);
+        writeUint32(out, tilesX);
+        writeUint32(out, tilesY);
+        out.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+        offset += tilesX * tilesY * tileBytes;
+    }
+
+    std::vector<uint8_t> tile(tileBytes);
+    for (int l{ 0 }; l < static_cast<int>(image.levels.size()); ++l) {
+        const auto &level{ image.levels[l] };
+        for (int tileY{ 0 }; tileY * tileSize < level.height; ++tileY) {
+            for (int tileX{ 0 }; tileX * tileSize < level.width; ++tileX) {
+                for (int y{ 0 }; y < tileSize; ++y) {
+                    for (int x{ 0 }; x < tileSize; ++x) {
+                        const uint8_t *texel{ image.texel(l,
+                            std::min(tileX * tileSize + x, level.width - 1), std::min(tileY * tileSize + y, level.height - 1)) };
+                        std::copy(texel, texel + 3, &tile[(static_cast<size_t>(y) * tileSize + x) * 3]);
+                    }
+                }
+                out.write(reinterpret_cast<const char *>(tile.data()), tileBytes);
+            }
+        }
+    }
+    if (!out) throw "Cannot write tiled texture file.";
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+    Tiled texture file (filename + ".tiled"), written by writeTiledTexture:
+        header      "PBTX", version, width, height, tileSize, levelCount   (uint32 each)
+        levels      width, height, tilesX, tilesY (uint32), offset (uint64) of every mip level
+        tiles       per level row by row, tileSize * tileSize texels of 8-bit RGB each,
+                    edge tiles padded with the last row and column
+    Every tile sits at offset + (tileY * tilesX + tileX) * tileBytes, so one read fetches it.
+*/
+struct TiledTextureInfo {
+    struct Level {
+        int width{ 0 }, height{ 0 }, tilesX{ 0 }, tilesY{ 0 };
+        uint64_t offset{ 0 };
+    };
+    int width{ 0 }, height{ 0 }, tileSize{ 0 };
+    std::vector<Level> levels;
+
+    size_t tileBytes() const { return static_cast<size_t>(tileSize) * tileSize * 3; }
+};
+
+struct TextureCacheStats {
+    long long hits{ 0 }, misses{ 0 }, evictions{ 0 };
+    size_t residentBytes{ 0 }, budgetBytes{ 0 };
+    int files{ 0 };
+
+    double hitRate() const { return hits + misses ? 1.0 * hits / (hits + misses) : 0.0; }
+    void print() const;
+};
+
+struct TextureCache {
+    /*
+        Tiles of every tiled texture, loaded on first access and kept within budgetBytes.
+        Tiles spread over SHARDS by key, each shard with its own lock, hash map and clock
+        hand, so threads looking up different tiles rarely wait on each other. A tile is
+        read without holding its shard lock, and only a miss touches the file.
+        Lookups get a TilePointer: a tile evicted while in use stays alive until released.
+        Each thread also remembers its RECENT last tiles and finds them without any lock;
+        those may outlive eviction too, adding at most RECENT tiles per thread to the budget.
+        The clock bit lives with the tile, so these lock free hits keep hot tiles resident.
+    */
+    using TilePointer = std::shared_ptr<const std::vector<uint8_t>>;
+
+    explicit TextureCache(size_t budget = size_t(256) << 20) : budgetBytes(budget), serial(++instances) {}
+    TextureCache(const TextureCache &) = delete;
+    TextureCache &operator=(const TextureCache &) = delete;
+
+    // Reads the header of a tiled texture file. The returned id names it in tile().
+    int open(const std::string &filename, TiledTextureInfo &info);
+    // Takes effect as tiles are loaded, nothing is evicted right away.
+    void setBudget(size_t bytes) { budgetBytes = bytes; }
+    TilePointer tile(int file, int level, int tileX, int tileY);
+    TextureCacheStats stats() const;
+    void print() const { stats().print(); }
+
+private:
+    static constexpr int SHARDS{ 16 };
+    static constexpr int RECENT{ 8 };
+    struct Tile {
+        std::vector<uint8_t> texels;
+        std::atomic<bool> referenced{ true };  // clock bit, set on every hit
+    };
+    using TileHandle = std::shared_ptr<Tile>;
+    struct Recent {
+        uint64_t cache{ 0 }, key{ 0 };
+        TileHandle tile;
+    };
+    struct Slot {
+        uint64_t key{ 0 };
+        TileHandle tile;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, size_t> slotOf;
+        std::vector<Slot> slots;
+        size_t hand{ 0 };
+        size_t bytes{ 0 };
+    };
+    struct File {
+        std::mutex mutex;
+        std::ifstream stream;
+        TiledTextureInfo info;
+    };
+
+    std::atomic<size_t> budgetBytes;
+    uint64_t serial;  // tells caches apart in the per thread recent tiles, addresses can be reused
+    static std::atomic<uint64_t> instances;
+    Shard shards[SHARDS];
+    mutable std::mutex filesMutex;
+    std::vector<std::unique_ptr<File>> files;
+    std::atomic<long long> hits{ 0 }, misses{ 0 }, evictions{ 0 };
+    std::atomic<size_t> residentBytes{ 0 };
+
+    File &file(int id) const;
+    TileHandle shared(uint64_t key, int file, int level, int tileX, int tileY);
+    TileHandle load(int file, int level, int tileX, int tileY);
+    void evictOne(Shard &shard);
+};
+
+// Cache shared by every TiledImageTexture unless one is given.
+TextureCache &textureCache();
+
+// Converts an image to the tiled file format, mip levels included.
+struct ImageTexture;
+void writeTiledTexture(const std::string &filename, const ImageTexture &image, int tileSize = 64);
@@ -1,10 +1,11 @@
 #pragma once
 #include "Transformation.h"
 
-Transformation::Transformation(tfType tt, double degree) {
+template <typename Scalar>
+TransformationT<Scalar>::TransformationT(tfType tt, Scalar degree) {
     // Passed by degree, not radian
-    degree = degree / 180. * PI;
-    double s{ sin(degree) }, c{ cos(degree) };
+    degree = degree / Scalar(180) * Scalar(PI);
+    Scalar s{ std::sin(degree) }, c{ std::cos(degree) };
 
     switch (tt) {
     case RX: components = { 1., 0., 0., 0., 0., c, -s, 0., 0., s, c, 0., 0., 0., 0., 1. }; break;
@@ -14,7 +15,8 @@ Transformation::Transformation(tfType tt, double degree) {
     }
 }
 
-Transformation::Transformation(tfType tt, double x, double y, double z) {
+template <typename Scalar>
+TransformationT<Scalar>::TransformationT(tfType tt, Scalar x, Scalar y, Scalar z) {
     // scale, translation
     switch (tt) {
     case S: components = { x, 0., 0., 0., 0., y, 0., 0., 0., 0., z, 0., 0., 0., 0., 1. }; break;
@@ -23,8 +25,9 @@ Transformation::Transformation(tfType tt, double x, double y, double z) {
     }
 }
 
-Transformation Transformation::operator * (const Transformation &trans) const {
-    Transformation result;
+template <typename Scalar>
+TransformationT<Scalar> TransformationT<Scalar>::operator * (const TransformationT &trans) const {
+    TransformationT result;
     for (int row{ 0 }; row < 3; row++) {
         for (int column{ 0 }; column < 4; column++) {
             result.components[row * 4 + column] =
@@ -37,8 +40,9 @@ Transformation Transformation::operator * (const Transformation &trans) const {
     return result;
 }
 
-Transformation Transformation::operator / (double n) const {
-    Transformation result;
+template <typename Scalar>
+TransformationT<Scalar> TransformationT<Scalar>::operator / (Scalar n) const {
+    TransformationT result;
     for (int row{ 0 }; row < 3; row++) {
         for (int column{ 0 }; column < 4; column++) {
             result.components[row * 4 + column] = components[row * 4 + column] / n;
@@ -47,7 +51,8 @@ Transformation Transformation::operator / (double n) const {
     return result;
 }
 
-std::ostream &operator<<(std::ostream &s, const Transformation &trans) {
+template <typename Scalar>
+std::ostream &operator<<(std::ostream &s, const TransformationT<Scalar> &trans) {
     for (int i{ 0 }; i < 4; i++) {
         s << "["
             << '\t' << trans.components[i * 4 + 0] << ", "
@@ -58,9 +63,10 @@ std::ostream &operator<<(std::ostream &s, const Transformation &trans) {
     return s;
 }
 
-Transformation Transformation::transposed() const {
+template <typename Scalar>
+TransformationT<Scalar> TransformationT<Scalar>::transposed() const {
     auto &cp = components;
-    return Transformation({
+    return TransformationT({
         cp[0], cp[4], cp[8], cp[12],
         cp[1], cp[5], cp[9], cp[13],
         cp[2], cp[6], cp[10], cp[14],
@@ -68,27 +74,29 @@ Transformation Transformation::transposed() const {
         });
 }
 
-double Transformation::determinant() const {
+template <typename Scalar>
+Scalar TransformationT<Scalar>::determinant() const {
     auto &cp = components;
     return cp[0] * (cp[5] * cp[10] - cp[6] * cp[9]) -
         cp[1] * (cp[4] * cp[10] - cp[6] * cp[8]) +
         cp[2] * (cp[4] * cp[9] - cp[5] * cp[8]);
 }
 
-Transformation Transformation::inverted() const {
-    double dt{ determinant() };
-    if (dt == 0.) throw "Transformation is singular (zero determinant).";
-    Transformation trans;
+template <typename Scalar>
+TransformationT<Scalar> TransformationT<Scalar>::inverted() const {
+    Scalar dt{ determinant() };
+    if (dt == Scalar(0)) throw "Transformation is singular (zero determinant).";
+    TransformationT trans;
 
     for (int row{ 0 }; row < 4; row++) {
         for (int column{ 0 }; column < 4; column++) {
-            double m[9];
+            Scalar m[9];
             for (int i{ 0 }; i < 3; i++) {
                 for (int j{ 0 }; j < 3; j++) {
                     m[i * 3 + j] = components[(i < row ? i : i + 1) * 4 + (j < column ? j : j + 1)];
                 }
             }
-            double mDeterminant = m[0] * (m[4] * m[8] - m[5] * m[7]) -
+            Scalar mDeterminant = m[0] * (m[4] * m[8] - m[5] * m[7]) -
                 m[1] * (m[3] * m[8] - m[5] * m[6]) +
                 m[2] * (m[3] * m[7] - m[4] * m[6]);
             // ккͬͬżʽΪ֮Ϊ
@@ -96,4 +104,9 @@ Transformation Transformation::inverted() const {
         }
     }
     return trans.transposed() / dt;
-}
\ No newline at end of file
+}
+
+template struct TransformationT<float>;
+template struct TransformationT<double>;
+template std::ostream &operator<<(std::ostream &s, const TransformationT<float> &trans);
+template std::ostream &operator<<(std::ostream &s, const TransformationT<double> &trans);
@@ -2,27 +2,32 @@
 #include "utility.h"
 #include <array>
 
-struct Transformation {
+template <typename Scalar>
+struct TransformationT {
     // Scale Translation RotationX RotationY RotationZ
     enum tfType { S, T, RX, RY, RZ };
 
-    std::array<double, 16> components{
+    std::array<Scalar, 16> components{
         1., 0., 0., 0.,
         0., 1., 0., 0.,
         0., 0., 1., 0.,
         0., 0., 0., 1.
     };
 
-    Transformation() = default;
-    Transformation(const std::array<double, 16> &c) : components(c) {}
-    Transformation(tfType tt, double degree);  // rotationX, rotationY, rotationZ
-    Transformation(tfType tt, double x, double y, double z);  // scale, translation
+    TransformationT() = default;
+    TransformationT(const std::array<Scalar, 16> &c) : components(c) {}
+    TransformationT(tfType tt, Scalar degree);  // rotationX, rotationY, rotationZ
+    TransformationT(tfType tt, Scalar x, Scalar y, Scalar z);  // scale, translation
 
-    double determinant() const;
-    Transformation inverted() const;
-    Transformation transposed() const;
-    Transformation operator *(const Transformation &trans) const;
-    Transformation operator /(double n) const;
-    double &operator [](int i) { return components[i]; }
-    friend std::ostream &operator<<(std::ostream &s, const Transformation &trans);
-};
\ No newline at end of file
+    Scalar determinant() const;
+    TransformationT inverted() const;
+    TransformationT transposed() const;
+    TransformationT operator *(const TransformationT &trans) const;
+    TransformationT operator /(Scalar n) const;
+    Scalar &operator [](int i) { return components[i]; }
+    template <typename U>
+    friend std::ostream &operator<<(std::ostream &s, const TransformationT<U> &trans);
+};
+
+// Scene setup and inversion stay in double whatever Real is; points are converted on use.
+using Transformation = TransformationT<double>;
\ No newline at end of file
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include "SIMD.h"
+#include "Vector.h"
+
+// Triangles per block: one AVX register of floats, or one SSE register without AVX.
+#if PBRT_AVX
+constexpr int TRIANGLE_BLOCK_WIDTH{ 8 };
+#else
+constexpr int TRIANGLE_BLOCK_WIDTH{ 4 };
+#endif
+
+template <int W>
+struct alignas(32) TriangleBlock {
+    /*
+        W triangles of one BVH leaf in SoA form, so one SIMD sequence runs Moller-Trumbore
+        for one ray against all of them with a single division.
+        The float test only shortlists. The caller confirms the closest candidate at full
+        precision from the same vertices, which sit in the block already, so no trip
+        through the index buffer. Unused lanes are degenerate: determinant 0, never hit.
+        Vertices are stored rather than A and the edges B - A, C - A: hitTriangle forms
+        the edges from the vertices, and the confirm only matches it bit for bit when
+        it starts from the same vertices. Two subtractions per lane are cheap next to that.
+    */
+    float ax[W], ay[W], az[W];
+    float bx[W], by[W], bz[W];
+    float cx[W], cy[W], cz[W];
+    uint32_t triangle[W];  // triangle index of each lane in the owner's index buffer
+
+    TriangleBlock();
+    void set(int lane, uint32_t tri, const float a[3], const float b[3], const float c[3]);
+    Vec3 A(int lane) const { return Vec3(ax[lane], ay[lane], az[lane]); }
+    Vec3 B(int lane) const { return Vec3(bx[lane], by[lane], bz[lane]); }
+    Vec3 C(int lane) const { return Vec3(cx[lane], cy[lane], cz[lane]); }
+    // Bit i is set if lane i is hit inside (tMin, tMax), its distance is written to tHit[i].
+    int hit(const float origin[3], const float direction[3], float tMin, float tMax, float tHit[W]) const;
+
+private:
+#if PBRT_SSE
+    int hit4(int first, const float origin[3], const float direction[3], float tMin, float tMax, float tHit[4]) const;
+#endif
+};
+
+// Barycentric slack of the float test. With the origin far from a small triangle float loses
+// about 1e-4 here; candidates are confirmed anyway, so erring on the wide side is harmless.
+constexpr float TRIANGLE_BLOCK_SLACK{ 0.001f };
+
+template <int W>
+inline TriangleBlock<W>::TriangleBlock() {
+    for (int i{ 0 }; i < W; ++i) {
+        ax[i] = ay[i] = az[i] = 0.0f;
+        bx[i] = by[i] = bz[i] = 0.0f;
+        cx[i] = cy[i] = cz[i] = 0.0f;
+        triangle[i] = 0;
+    }
+}
+
+template <int W>
+inline void TriangleBlock<W>::set(int lane, uint32_t tri, const float a[3], const float b[3], const float c[3]) {
+    ax[lane] = a[0]; ay[lane] = a[1]; az[lane] = a[2];
+    bx[lane] = b[0]; by[lane] = b[1]; bz[lane] = b[2];
+    cx[lane] = c[0]; cy[lane] = c[1]; cz[lane] = c[2];
+    triangle[lane] = tri;
+}
+
+template <int W>
+inline int TriangleBlock<W>::hit(
+    const float origin[3], const float direction[3], float tMin, float tMax, float tHit[W]) const {
+    // Scalar fallback, laid out so the compiler can still vectorize it.
+    int mask{ 0 };
+    for (int i{ 0 }; i < W; ++i) {
+        float e1x{ bx[i] - ax[i] }, e1y{ by[i] - ay[i] }, e1z{ bz[i] - az[i] };
+        float e2x{ cx[i] - ax[i] }, e2y{ cy[i] - ay[i] }, e2z{ cz[i] - az[i] };
+        float pX{ direction[1] * e2z - direction[2] * e2y };
+        float pY{ direction[2] * e2x - direction[0] * e2z };
+        float pZ{ direction[0] * e2y - direction[1] * e2x };
+        float invDet{ 1.0f / (e1x * pX + e1y * pY + e1z * pZ) };
+        float sX{ origin[0] - ax[i] }, sY{ origin[1] - ay[i] }, sZ{ origin[2] - az[i] };
+        float beta{ (sX * pX + sY * pY + sZ * pZ) * invDet };
+        float qX{ sY * e1z - sZ * e1y };
+        float qY{ sZ * e1x - sX * e1z };
+        float qZ{ sX * e1y - sY * e1x };
+        float gamma{ (direction[0] * qX + direction[1] * qY + direction[2] * qZ) * invDet };
+        float t{ (e2x * qX + e2y * qY + e2z * qZ) * invDet };
+        tHit[i] = t;
+        // NaN from empty lanes fails every comparison.
+        mask |= (beta >= -TRIANGLE_BLOCK_SLACK && gamma >= -TRIANGLE_BLOCK_SLACK &&
+            beta + gamma <= 1.0f + TRIANGLE_BLOCK_SLACK && t > tMin && t < tMax) << i;
+    }
+    return mask;
+}
+
+#if PBRT_SSE
+template <int W>
+inline int TriangleBlock<W>::hit4(
+    int first, const float origin[3], const float direction[3], float tMin, float tMax, float tHit[4]) const {
+    // Lanes [first, first + 4) against one ray.
+    const __m128 dx{ _mm_set1_ps(direction[0]) }, dy{ _mm_set1_ps(direction[1]) }, dz{ _mm_set1_ps(direction[2]) };
+    const __m128 Ax{ _mm_loadu_ps(ax + first) }, Ay{ _mm_loadu_ps(ay + first) }, Az{ _mm_loadu_ps(az + first) };
+    const __m128 E1x{ _mm_sub_ps(_mm_loadu_ps(bx + first), Ax) };
+    const __m128 E1y{ _mm_sub_ps(_mm_loadu_ps(by + first), Ay) };
+    const __m128 E1z{ _mm_sub_ps(_mm_loadu_ps(bz + first), Az) };
+    const __m128 E2x{ _mm_sub_ps(_mm_loadu_ps(cx + first), Ax) };
+    const __m128 E2y{ _mm_sub_ps(_mm_loadu_ps(cy + first), Ay) };
+    const __m128 E2z{ _mm_sub_ps(_mm_loadu_ps(cz + first), Az) };
+    __m128 pX{ _mm_sub_ps(_mm_mul_ps(dy, E2z), _mm_mul_ps(dz, E2y)) };
+    __m128 pY{ _mm_sub_ps(_mm_mul_ps(dz, E2x), _mm_mul_ps(dx, E2z)) };
+    __m128 pZ{ _mm_sub_ps(_mm_mul_ps(dx, E2y), _mm_mul_ps(dy, E2x)) };
+    __m128 det{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(E1x, pX), _mm_mul_ps(E1y, pY)), _mm_mul_ps(E1z, pZ)) };
+    __m128 invDet{ _mm_div_ps(_mm_set1_ps(1.0f), det) };
+    __m128 sX{ _mm_sub_ps(_mm_set1_ps(origin[0]), Ax) };
+    __m128 sY{ _mm_sub_ps(_mm_set1_ps(origin[1]), Ay) };
+    __m128 sZ{ _mm_sub_ps(_mm_set1_ps(origin[2]), Az) };
+    __m128 beta{ _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, pX), _mm_mul_ps(sY, pY)), _mm_mul_ps(sZ, pZ)), invDet) };
+    __m128 qX{ _mm_sub_ps(_mm_mul_ps(sY, E1z), _mm_mul_ps(sZ, E1y)) };
+    __m128 qY{ _mm_sub_ps(_mm_mul_ps(sZ, E1x), _mm_mul_ps(sX, E1z)) };
+    __m128 qZ{ _mm_sub_ps(_mm_mul_ps(sX, E1y), _mm_mul_ps(sY, E1x)) };
+    __m128 gamma{ _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qX), _mm_mul_ps(dy, qY)), _mm_mul_ps(dz, qZ)), invDet) };
+    __m128 t{ _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(E2x, qX), _mm_mul_ps(E2y, qY)), _mm_mul_ps(E2z, qZ)), invDet) };
+    _mm_storeu_ps(tHit, t);
+    const __m128 slack{ _mm_set1_ps(-TRIANGLE_BLOCK_SLACK) };
+    __m128 inside{ _mm_and_ps(_mm_cmpge_ps(beta, slack), _mm_cmpge_ps(gamma, slack)) };
+    inside = _mm_and_ps(inside, _mm_cmple_ps(_mm_add_ps(beta, gamma), _mm_set1_ps(1.0f + TRIANGLE_BLOCK_SLACK)));
+    inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpgt_ps(t, _mm_set1_ps(tMin)), _mm_cmplt_ps(t, _mm_set1_ps(tMax))));
+    return _mm_movemask_ps(inside);
+}
+
+template <>
+inline int TriangleBlock<4>::hit(
+    const float origin[3], const float direction[3], float tMin, float tMax, float tHit[4]) const {
+    return hit4(0, origin, direction, tMin, tMax, tHit);
+}
+
+#if !PBRT_AVX
+template <>
+inline int TriangleBlock<8>::hit(
+    const float origin[3], const float direction[3], float tMin, float tMax, float tHit[8]) const {
+    // No AVX: two SSE halves.
+    return hit4(0, origin, direction, tMin, tMax, tHit) | hit4(4, origin, direction, tMin, tMax, tHit + 4) << 4;
+}
+#endif
+#endif
+
+#if PBRT_AVX
+template <>
+inline int TriangleBlock<8>::hit(
+    const float origin[3], const float direction[3], float tMin, float tMax, float tHit[8]) const {
+    const __m256 dx{ _mm256_set1_ps(direction[0]) }, dy{ _mm256_set1_ps(direction[1]) }, dz{ _mm256_set1_ps(direction[2]) };
+    const __m256 Ax{ _mm256_load_ps(ax) }, Ay{ _mm256_load_ps(ay) }, Az{ _mm256_load_ps(az) };
+    const __m256 E1x{ _mm256_sub_ps(_mm256_load_ps(bx), Ax) };
+    const __m256 E1y{ _mm256_sub_ps(_mm256_load_ps(by), Ay) };
+    const __m256 E1z{ _mm256_sub_ps(_mm256_load_ps(bz), Az) };
+    const __m256 E2x{ _mm256_sub_ps(_mm256_load_ps(cx), Ax) };
+    const __m256 E2y{ _mm256_sub_ps(_mm256_load_ps(cy), Ay) };
+    const __m256 E2z{ _mm256_sub_ps(_mm256_load_ps(cz), Az) };
+    __m256 pX{ _mm256_sub_ps(_mm256_mul_ps(dy, E2z), _mm256_mul_ps(dz, E2y)) };
+    __m256 pY{ _mm256_sub_ps(_mm256_mul_ps(dz, E2x), _mm256_mul_ps(dx, E2z)) };
+    __m256 pZ{ _mm256_sub_ps(_mm256_mul_ps(dx, E2y), _mm256_mul_ps(dy, E2x)) };
+    __m256 det{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(E1x, pX), _mm256_mul_ps(E1y, pY)), _mm256_mul_ps(E1z, pZ)) };
+    __m256 invDet{ _mm256_div_ps(_mm256_set1_ps(1.0f), det) };
+    __m256 sX{ _mm256_sub_ps(_mm256_set1_ps(origin[0]), Ax) };
+    __m256 sY{ _mm256_sub_ps(_mm256_set1_ps(origin[1]), Ay) };
+    __m256 sZ{ _mm256_sub_ps(_mm256_set1_ps(origin[2]), Az) };
+    __m256 beta{ _mm256_mul_ps(
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sX, pX), _mm256_mul_ps(sY, pY)), _mm256_mul_ps(sZ, pZ)), invDet) };
+    __m256 qX{ _mm256_sub_ps(_mm256_mul_ps(sY, E1z), _mm256_mul_ps(sZ, E1y)) };
+    __m256 qY{ _mm256_sub_ps(_mm256_mul_ps(sZ, E1x), _mm256_mul_ps(sX, E1z)) };
+    __m256 qZ{ _mm256_sub_ps(_mm256_mul_ps(sX, E1y), _mm256_mul_ps(sY, E1x)) };
+    __m256 gamma{ _mm256_mul_ps(
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qX), _mm256_mul_ps(dy, qY)), _mm256_mul_ps(dz, qZ)), invDet) };
+    __m256 t{ _mm256_mul_ps(
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(E2x, qX), _mm256_mul_ps(E2y, qY)), _mm256_mul_ps(E2z, qZ)), invDet) };
+    _mm256_storeu_ps(tHit, t);
+    const __m256 slack{ _mm256_set1_ps(-TRIANGLE_BLOCK_SLACK) };
+    __m256 inside{ _mm256_and_ps(_mm256_cmp_ps(beta, slack, _CMP_GE_OQ), _mm256_cmp_ps(gamma, slack, _CMP_GE_OQ)) };
+    inside = _mm256_and_ps(inside,
+        _mm256_cmp_ps(_mm256_add_ps(beta, gamma), _mm256_set1_ps(1.0f + TRIANGLE_BLOCK_SLACK), _CMP_LE_OQ));
+    inside = _mm256_and_ps(inside, _mm256_and_ps(
+        _mm256_cmp_ps(t, _mm256_set1_ps(tMin), _CMP_GT_OQ), _mm256_cmp_ps(t, _mm256_set1_ps(tMax), _CMP_LT_OQ)));
+    return _mm256_movemask_ps(inside);
+}
+#endif
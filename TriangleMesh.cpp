@@ -0,0 +1,167 @@
+#include "TriangleMesh.h"
+
+size_t TriangleMesh::memoryBytes() const {
+    size_t bytes{ sizeof(*this) };
+    for (auto *attribute : { &px, &py, &pz, &u, &v, &nx, &ny, &nz }) bytes += attribute->capacity() * sizeof(float);
+    bytes += indices.capacity() * sizeof(uint32_t);
+    bytes += nodes.capacity() * sizeof(LinearBVHNode);
+    bytes += blocks.capacity() * sizeof(TriangleBlock<TRIANGLE_BLOCK_WIDTH>);
+    return bytes;
+}
+
+bool TriangleMesh::hitTriangle(const TriangleBlock<TRIANGLE_BLOCK_WIDTH> &block, int lane,
+    const Ray &ray, double tMin, double tMax, HitRec &rec) const {
+    /*
+        Moller-Trumbore: solve o + td = A + beta*(B-A) + gamma*(C-A) by Cramer's rule.
+        Full precision check of one block lane. The index buffer is only read for
+        the attributes of an accepted hit.
+    */
+    Vec3 A{ block.A(lane) };
+    Vec3 AB{ block.B(lane) - A }, AC{ block.C(lane) - A };
+    const Vec3 &D{ ray.direction };
+
+    Vec3 pVec{ D ^ AC };
+    double determinant{ AB * pVec };
+    if (determinant == 0.0) return false;
+    double invDet{ 1.0 / determinant };
+
+    Vec3 AO{ ray.origin - A };
+    double beta{ AO * pVec * invDet };
+    if (beta < 0.0 || beta > 1.0) return false;
+    Vec3 qVec{ AO ^ AB };
+    double gamma{ D * qVec * invDet };
+    // Same tolerance as Triangle, rays exactly on an edge must not slip through.
+    if (gamma < 0.0 || beta + gamma > 1.00000001) return false;
+    double t{ AC * qVec * invDet };
+    if (t < tMin || t > tMax) return false;
+
+    double alpha{ 1.0 - beta - gamma };
+    uint32_t triangle{ block.triangle[lane] };
+    uint32_t ia{ indices[triangle * 3] }, ib{ indices[triangle * 3 + 1] }, ic{ indices[triangle * 3 + 2] };
+    rec.t = t;
+    rec.p = ray.pointAtT(t);
+    rec.geometricNormal = (AB ^ AC).normalized();
+    if (hasNormal()) {
+        rec.normal = Vec3(
+            nx[ia] * alpha + nx[ib] * beta + nx[ic] * gamma,
+            ny[ia] * alpha + ny[ib] * beta + ny[ic] * gamma,
+            nz[ia] * alpha + nz[ib] * beta + nz[ic] * gamma).normalized();
+    } else rec.normal = rec.geometricNormal;
+    rec.matId = matId;
+    if (hasUV()) {
+        rec.uv = Vec2(
+            u[ia] * alpha + u[ib] * beta + u[ic] * gamma,
+            v[ia] * alpha + v[ib] * beta + v[ic] * gamma);
+    } else rec.uv = uv(Vec3(alpha, beta, gamma));
+    return true;
+}
+
+bool TriangleMesh::hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const {
+    constexpr int W{ TRIANGLE_BLOCK_WIDTH };
+    const float origin[3]{
+        static_cast<float>(ray.origin.x), static_cast<float>(ray.origin.y), static_cast<float>(ray.origin.z) };
+    const float direction[3]{
+        static_cast<float>(ray.direction.x), static_cast<float>(ray.direction.y), static_cast<float>(ray.direction.z) };
+    float tMinF{ static_cast<float>(tMin) };
+
+    return traverseLinearBVH(nodes, ray, tMin, tMax, [&](int offset, int primCount, double &tMaxLeaf) {
+        bool hitLeaf{ false };
+        for (int b{ 0 }; b < (primCount + W - 1) / W; ++b) {
+            const TriangleBlock<W> &block{ blocks[offset + b] };
+            float tHit[W];
+            int mask{ block.hit(origin, direction, tMinF, static_cast<float>(tMaxLeaf) * 1.0000004f, tHit) };
+            // Closest candidate first. The float test only shortlists, hitTriangle decides at full
+            // precision. Candidates within float error of an accepted hit may still be closer.
+            while (mask) {
+                int closest{ -1 };
+                for (int i{ 0 }; i < W; ++i) {
+                    if ((mask >> i & 1) && (closest < 0 || tHit[i] < tHit[closest])) closest = i;
+                }
+                if (hitLeaf && tHit[closest] > tMaxLeaf * 1.00001) break;
+                mask &= ~(1 << closest);
+                if (hitTriangle(block, closest, ray, tMin, tMaxLeaf, rec)) {
+                    hitLeaf = true;
+                    tMaxLeaf = rec.t;
+                }
+            }
+        }
+        return hitLeaf;
+    });
+}
+
+void TriangleMesh::makeAABB() {
+    std::vector<BVHBuildPrim> buildPrims;
+    buildPrims.reserve(triangleCount());
+    AABB bounds;
+    for (uint32_t i{ 0 }; i < triangleCount(); ++i) {
+        Vec3 a{ position(indices[i * 3]) }, b{ position(indices[i * 3 + 1]) }, c{ position(indices[i * 3 + 2]) };
+        Vec3 minB{ minVec3(minVec3(a, b), c) }, maxB{ maxVec3(maxVec3(a, b), c) };
+        buildPrims.emplace_back(minB, maxB, i);
+        bounds += AABB(minB, maxB, 0.0);
+    }
+    box = AABB(bounds.minBound, bounds.maxBound);
+    centroid = box.center;
+
+    // Leaves reference triangles by position in the index buffer, so put the faces in leaf order.
+    BinnedSAHBuilder builder(maxLeafSize);
+    builder.blockWidth = TRIANGLE_BLOCK_WIDTH;
+    builder.build(buildPrims, nodes);
+    std::vector<uint32_t> ordered;
+    ordered.reserve(indices.size());
+    for (const auto &bp : buildPrims) {
+        ordered.push_back(indices[bp.index * 3]);
+        ordered.push_back(indices[bp.index * 3 + 1]);
+        ordered.push_back(indices[bp.index * 3 + 2]);
+    }
+    indices.swap(ordered);
+
+    // Pack every leaf into blocks and point the leaf at its first block.
+    constexpr int W{ TRIANGLE_BLOCK_WIDTH };
+    blocks.clear();
+    for (auto &node : nodes) {
+        if (!node.primCount) continue;
+        int firstBlock{ static_cast<int>(blocks.size()) };
+        blocks.resize(blocks.size() + (node.primCount + W - 1) / W);
+        for (int i{ 0 }; i < node.primCount; ++i) {
+            uint32_t triangle{ static_cast<uint32_t>(node.offset + i) };
+            float vertex[3][3];
+            for (int k{ 0 }; k < 3; ++k) {
+                uint32_t index{ indices[triangle * 3 + k] };
+                vertex[k][0] = px[index];
+                vertex[k][1] = py[index];
+                vertex[k][2] = pz[index];
+            }
+            blocks[firstBlock + i / W].set(i % W, triangle, vertex[0], vertex[1], vertex[2]);
+        }
+        node.offset = firstBlock;
+    }
+}
+
+void TriangleMesh::printSelf() const {
+    std::cout << "TriangleMesh " << triangleCount() << " triangles " << vertexCount() << " vertices "
+        << (triangleCount() ? memoryBytes() / static_cast<double>(triangleCount()) : 0.0) << " bytes/triangle "
+        << typeid(MaterialTable::get(matId)).name();
+}
+
+void TriangleMesh::transform(const Transformation &trans) {
+    for (size_t i{ 0 }; i < vertexCount(); ++i) {
+        Vec3 p{ position(static_cast<uint32_t>(i)) * trans };
+        px[i] = static_cast<float>(p.x);
+        py[i] = static_cast<float>(p.y);
+        pz[i] = static_cast<float>(p.z);
+    }
+    if (hasNormal()) {
+        // Normals go through the inverse transpose, translation dropped.
+        Transformation normalTrans{ trans.inverted().transposed() };
+        normalTrans[3] = 0.0;
+        normalTrans[7] = 0.0;
+        normalTrans[11] = 0.0;
+        for (size_t i{ 0 }; i < vertexCount(); ++i) {
+            Vec3 n{ (Vec3(nx[i], ny[i], nz[i]) * normalTrans).normalized() };
+            nx[i] = static_cast<float>(n.x);
+            ny[i] = static_cast<float>(n.y);
+            nz[i] = static_cast<float>(n.z);
+        }
+    }
+    centroid *= trans;
+}
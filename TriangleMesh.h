@@ -0,0 +1,49 @@
+#pragma once
+
+#include "LinearBVH.h"
+#include "TriangleBlock.h"
+
+struct TriangleMesh : public Primitive {
+    /*
+        Indexed triangle mesh. Vertices are shared between faces and kept in SoA
+        float arrays, faces are three uint32_t indices. One material for the
+        whole mesh, one BVH over its triangles, one entry in the scene BVH.
+
+        Triangle primitive: seven double Vec3, three Vec2, AABB and Primitive
+        base, several hundred bytes per face. Here: 12 bytes of indices plus
+        the shared vertex data and the mesh BVH.
+        Each BVH leaf also keeps its triangles in SIMD blocks, which the ray
+        is tested against first.
+    */
+    // Vertex attributes, SoA. uv and normal arrays are either empty or as long as positions.
+    std::vector<float> px, py, pz;
+    std::vector<float> u, v;
+    std::vector<float> nx, ny, nz;
+    // Three vertex indices per triangle. Reordered by the BVH build, leaves are contiguous.
+    std::vector<uint32_t> indices;
+    // Leaf offset: first block in blocks. primCount stays the number of triangles.
+    std::vector<LinearBVHNode> nodes;
+    std::vector<TriangleBlock<TRIANGLE_BLOCK_WIDTH>> blocks;
+    int maxLeafSize{ TRIANGLE_BLOCK_WIDTH };
+
+    TriangleMesh() = default;
+    template <typename MaterialType>
+    TriangleMesh(const MaterialType &m) : Primitive(m) {}
+
+    size_t vertexCount() const { return px.size(); }
+    size_t triangleCount() const { return indices.size() / 3; }
+    bool hasUV() const { return !u.empty(); }
+    bool hasNormal() const { return !nx.empty(); }
+    Vec3 position(uint32_t i) const { return Vec3(px[i], py[i], pz[i]); }
+    size_t memoryBytes() const;
+
+    bool hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const override;
+    void makeAABB() override;  // also (re)builds the mesh BVH, so transform() first
+    virtual void printSelf() const override;
+    virtual Vec2 uv(const Vec3 &p) const override { return Vec2(p.y, p.z); }
+    virtual void transform(const Transformation &trans) override;
+
+private:
+    bool hitTriangle(const TriangleBlock<TRIANGLE_BLOCK_WIDTH> &block, int lane,
+        const Ray &ray, double tMin, double tMax, HitRec &rec) const;
+};
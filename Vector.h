@@ -2,100 +2,106 @@
 #include <cmath>
 #include <iostream>
 #include <array>
+#include "Real.h"
 #include "Transformation.h"
 
-struct Vec3 {
-    double x{ 0.0 }, y{ 0.0 }, z{ 0.0 };
+template <typename T>
+struct Vec3T {
+    T x{ 0 }, y{ 0 }, z{ 0 };
 
-    Vec3() = default;
-    Vec3(double _x, double _y, double _z) : x(_x), y(_y),z(_z) {}
-    Vec3(double n) : x(n), y(n), z(n) {}
-    Vec3(const Vec3 &vec) : x(vec.x), y(vec.y), z(vec.z) {}
+    Vec3T() = default;
+    Vec3T(T _x, T _y, T _z) : x(_x), y(_y),z(_z) {}
+    Vec3T(T n) : x(n), y(n), z(n) {}
+    Vec3T(const Vec3T &vec) : x(vec.x), y(vec.y), z(vec.z) {}
+    template <typename U>
+    explicit Vec3T(const Vec3T<U> &vec) : x(static_cast<T>(vec.x)), y(static_cast<T>(vec.y)), z(static_cast<T>(vec.z)) {}
     
-    Vec3 operator+() const { return *this; };
-    Vec3 operator-() const { return Vec3(-x, -y, -z); };
-
-    Vec3 operator+(const Vec3 &vec) const { return Vec3(x + vec.x, y + vec.y, z + vec.z); }
-    Vec3 operator-(const Vec3 &vec) const { return Vec3(x - vec.x, y - vec.y, z - vec.z); }
-    Vec3 operator/(const Vec3 &vec) const { return Vec3(x / vec.x, y / vec.y, z / vec.z); }
-    Vec3 operator*(const double &n) const { return Vec3(x * n, y * n, z * n); }
-    Vec3 operator/(const double &n) const { return Vec3(x / n, y / n, z / n); }
-
-    double operator*(const Vec3 &vec) const { return x * vec.x + y * vec.y + z * vec.z; }
-
-    Vec3 &operator+=(const Vec3 &vec) { x += vec.x; y += vec.y; z += vec.z; return *this; }
-    Vec3 &operator-=(const Vec3 &vec) { x -= vec.x; y -= vec.y; z -= vec.z; return *this; }
-    Vec3 &operator*=(const double &n) { x *= n; y *= n; z *= n; return *this; }
-    Vec3 &operator/=(const double &n) { x /= n; y /= n; z /= n; return *this; }
-
-    double operator[](int n) { return n == 0 ? x : (n == 1 ? y : z); }
-    Vec3 &operator=(const Vec3 &vec) { x = vec.x; y = vec.y; z = vec.z; return *this; }
-    Vec3 operator^(const Vec3 &vec) const;
-    Vec3 &operator*=(const Transformation &trans);
-    Vec3 operator*(const Transformation &trans) const;
-
-    friend std::ostream &operator<<(std::ostream &os, const Vec3 &vec);
-    friend Vec3 operator*(const double &n, const Vec3 &vec);
-    friend Vec3 minVec3(const Vec3 &v1, const Vec3 &v2);
-    friend Vec3 maxVec3(const Vec3 &v1, const Vec3 &v2);
-
-    double length() const { return std::sqrt(x * x + y * y + z * z); }
-    Vec3 &normalize() { *this *= 1.0 / length(); return *this; }
-    Vec3 normalized() const { return *this * (1.0 / length());}
-    Vec3 switchXZ() const { return Vec3(z, y, x); }
-    double max(double n = 0.0) const { return std::max(std::max(std::max(x, y), z), n); }
-    double min(double n = 0.0) const { return std::min(std::min(std::min(x, y), z), n); }
-    Vec3 reciprocal() const { return Vec3(1.0 / x, 1.0 / y, 1.0 / z); }
-    Vec3 vecFloor() const { return Vec3(floor(x), floor(y), floor(z)); }
+    Vec3T operator+() const { return *this; };
+    Vec3T operator-() const { return Vec3T(-x, -y, -z); };
+
+    Vec3T operator+(const Vec3T &vec) const { return Vec3T(x + vec.x, y + vec.y, z + vec.z); }
+    Vec3T operator-(const Vec3T &vec) const { return Vec3T(x - vec.x, y - vec.y, z - vec.z); }
+    Vec3T operator/(const Vec3T &vec) const { return Vec3T(x / vec.x, y / vec.y, z / vec.z); }
+    Vec3T operator*(const T &n) const { return Vec3T(x * n, y * n, z * n); }
+    Vec3T operator/(const T &n) const { return Vec3T(x / n, y / n, z / n); }
+
+    T operator*(const Vec3T &vec) const { return x * vec.x + y * vec.y + z * vec.z; }
+
+    Vec3T &operator+=(const Vec3T &vec) { x += vec.x; y += vec.y; z += vec.z; return *this; }
+    Vec3T &operator-=(const Vec3T &vec) { x -= vec.x; y -= vec.y; z -= vec.z; return *this; }
+    Vec3T &operator*=(const T &n) { x *= n; y *= n; z *= n; return *this; }
+    Vec3T &operator/=(const T &n) { x /= n; y /= n; z /= n; return *this; }
+
+    T operator[](int n) const { return n == 0 ? x : (n == 1 ? y : z); }
+    Vec3T &operator=(const Vec3T &vec) { x = vec.x; y = vec.y; z = vec.z; return *this; }
+    Vec3T operator^(const Vec3T &vec) const;
+    template <typename U>
+    Vec3T &operator*=(const TransformationT<U> &trans);
+    template <typename U>
+    Vec3T operator*(const TransformationT<U> &trans) const;
+
+    // Hidden friends, so mixed scalar arguments still convert.
+    friend std::ostream &operator<<(std::ostream &os, const Vec3T &vec) {
+        os << "( " << vec.x << ", " << vec.y << ", " << vec.z << " )";
+        return os;
+    }
+    friend Vec3T operator*(const T &n, const Vec3T &vec) { return vec * n; }
+    friend Vec3T minVec3(const Vec3T &v1, const Vec3T &v2) {
+        return Vec3T(v1.x > v2.x ? v2.x : v1.x, v1.y > v2.y ? v2.y : v1.y, v1.z > v2.z ? v2.z : v1.z);
+    }
+    friend Vec3T maxVec3(const Vec3T &v1, const Vec3T &v2) {
+        return Vec3T(v1.x < v2.x ? v2.x : v1.x, v1.y < v2.y ? v2.y : v1.y, v1.z < v2.z ? v2.z : v1.z);
+    }
+
+    T length() const { return std::sqrt(x * x + y * y + z * z); }
+    Vec3T &normalize() { *this *= T(1) / length(); return *this; }
+    Vec3T normalized() const { return *this * (T(1) / length());}
+    Vec3T switchXZ() const { return Vec3T(z, y, x); }
+    T max(T n = 0) const { return std::max(std::max(std::max(x, y), z), n); }
+    T min(T n = 0) const { return std::min(std::min(std::min(x, y), z), n); }
+    Vec3T reciprocal() const { return Vec3T(T(1) / x, T(1) / y, T(1) / z); }
+    Vec3T vecFloor() const { return Vec3T(std::floor(x), std::floor(y), std::floor(z)); }
 };
 
-inline Vec3 Vec3::operator^(const Vec3 &vec) const {
+template <typename T>
+inline Vec3T<T> Vec3T<T>::operator^(const Vec3T &vec) const {
     // Cross
-    return Vec3(y * vec.z - z * vec.y, z * vec.x - x * vec.z, x * vec.y - y * vec.x);
+    return Vec3T(y * vec.z - z * vec.y, z * vec.x - x * vec.z, x * vec.y - y * vec.x);
 }
 
-inline Vec3 &Vec3::operator*=(const Transformation &trans) {
+template <typename T>
+template <typename U>
+inline Vec3T<T> &Vec3T<T>::operator*=(const TransformationT<U> &trans) {
     // Actually, it is LEFT multiplied by trans matrix, not right.
     auto &a = trans.components;
-    double nx = a[0] * x + a[1] * y + a[2] * z + a[3];
-    double ny = a[4] * x + a[5] * y + a[6] * z + a[7];
-    double nz = a[8] * x + a[9] * y + a[10] * z + a[11];
-    x = nx; y = ny; z = nz;
+    U nx = a[0] * x + a[1] * y + a[2] * z + a[3];
+    U ny = a[4] * x + a[5] * y + a[6] * z + a[7];
+    U nz = a[8] * x + a[9] * y + a[10] * z + a[11];
+    x = static_cast<T>(nx); y = static_cast<T>(ny); z = static_cast<T>(nz);
     return *this;
 }
 
-inline Vec3 Vec3::operator*(const Transformation &trans) const {
+template <typename T>
+template <typename U>
+inline Vec3T<T> Vec3T<T>::operator*(const TransformationT<U> &trans) const {
     // Actually, it is LEFT multiplied by trans matrix, not right.
-    auto &a = trans.components;
-    return Vec3(
-        a[0] * x + a[1] * y + a[2] * z + a[3],
-        a[4] * x + a[5] * y + a[6] * z + a[7],
-        a[8] * x + a[9] * y + a[10] * z + a[11]
-    );
+    Vec3T result{ *this };
+    return result *= trans;
 }
 
-inline std::ostream &operator<<(std::ostream &os, const Vec3 &vec) {
-    os << "( " << vec.x << ", " << vec.y << ", " << vec.z << " )";
-    return os;
-}
-
-inline Vec3 operator*(const double &n, const Vec3 &vec) { return vec * n; }
-
-inline Vec3 minVec3(const Vec3 &v1, const Vec3 &v2) {
-    return Vec3(v1.x > v2.x ? v2.x : v1.x, v1.y > v2.y ? v2.y : v1.y, v1.z > v2.z ? v2.z : v1.z);
-}
-inline Vec3 maxVec3(const Vec3 &v1, const Vec3 &v2) {
-    return Vec3(v1.x < v2.x ? v2.x : v1.x, v1.y < v2.y ? v2.y : v1.y, v1.z < v2.z ? v2.z : v1.z);
-}
+template <typename T>
+struct Vec2T {
+    T u{ 0 }, v{ 0 };
 
-struct Vec2 {
-    double u{ 0.0 }, v{ 0.0 };
+    Vec2T() = default;
+    Vec2T(T _u, T _v) : u(_u), v(_v) {}
+    Vec2T(const Vec2T &vec) : u(vec.u), v(vec.v) {}
+    Vec2T &operator=(const Vec2T &vec) = default;
 
-    Vec2() = default;
-    Vec2(double _u, double _v) : u(_u), v(_v) {}
-    Vec2(const Vec2 &vec) : u(vec.u), v(vec.v) {}
+    Vec2T operator+(const Vec2T &vec) const { return Vec2T(u + vec.u, v + vec.v); }
+    Vec2T operator-(const Vec2T &vec) const { return Vec2T(u - vec.u, v - vec.v); }
+    Vec2T operator*(const T &n) const { return Vec2T(u * n, v * n); }
+};
 
-    Vec2 operator+(const Vec2 &vec) const { return Vec2(u + vec.u, v + vec.v); }
-    Vec2 operator-(const Vec2 &vec) const { return Vec2(u - vec.u, v - vec.v); }
-    Vec2 operator*(const double &n) const { return Vec2(u * n, v * n); }
-};
\ No newline at end of file
+using Vec3 = Vec3T<Real>;
+using Vec2 = Vec2T<Real>;
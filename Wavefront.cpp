@@ -0,0 +1,235 @@
+#include "Camera.h"
+#include <chrono>
+#include <type_traits>
+
+SHADER shaderOf(const Material &mat) {
+    // Follows the type tag MaterialTable::classify gave the material.
+    if (mat.LIGHT) return LIGHT_SHADER;
+    switch (mat.type) {
+    case LAMBERTIAN_MATERIAL: return LAMBERTIAN_SHADER;
+    case METAL_MATERIAL: return METAL_SHADER;
+    case DIELECTRIC_MATERIAL: return DIELECTRIC_SHADER;
+    case ISOTROPIC_MATERIAL: return ISOTROPIC_SHADER;
+    default: return OTHER_SHADER;
+    }
+}
+
+void PathStates::resize(int n) {
+    for (auto *lane : { &ox, &oy, &oz, &dx, &dy, &dz }) lane->resize(n);
+    time.resize(n);
+    recs.resize(n);
+    throughput.resize(n);
+    radiance.resize(n);
+    scatterPDF.resize(n);
+    lightSampled.resize(n);
+    samplers.resize(n);
+}
+
+void PathStates::setRay(int i, const Ray &ray) {
+    ox[i] = ray.origin.x; oy[i] = ray.origin.y; oz[i] = ray.origin.z;
+    dx[i] = ray.direction.x; dy[i] = ray.direction.y; dz[i] = ray.direction.z;
+    time[i] = ray.time;
+}
+
+void ShadowQueue::clear() {
+    for (auto *lane : { &ox, &oy, &oz, &dx, &dy, &dz }) lane->clear();
+    time.clear();
+    radiance.clear();
+    path.clear();
+}
+
+void ShadowQueue::push(const Ray &ray, const Color &c, int pathIndex) {
+    ox.push_back(ray.origin.x); oy.push_back(ray.origin.y); oz.push_back(ray.origin.z);
+    dx.push_back(ray.direction.x); dy.push_back(ray.direction.y); dz.push_back(ray.direction.z);
+    time.push_back(ray.time);
+    radiance.push_back(c);
+    path.push_back(pathIndex);
+}
+
+WavefrontStats &WavefrontStats::operator+=(const WavefrontStats &s) {
+    generateMs += s.generateMs;
+    extendMs += s.extendMs;
+    shadeMs += s.shadeMs;
+    shadowMs += s.shadowMs;
+    waves += s.waves;
+    cameraRays += s.cameraRays;
+    extensionRays += s.extensionRays;
+    shadowRays += s.shadowRays;
+    return *this;
+}
+
+void WavefrontStats::print() const {
+    auto rate = [](long long rays, double ms) { return ms > 0.0 ? rays / ms / 1000.0 : 0.0; };
+    std::cout << "Wavefront: " << waves << " waves, thread time per stage\n"
+        << "  generate " << generateMs << " ms, " << cameraRays << " camera rays\n"
+        << "  extend   " << extendMs << " ms, " << extensionRays << " rays, " << rate(extensionRays, extendMs) << " Mrays/s\n"
+        << "  shade    " << shadeMs << " ms\n"
+        << "  shadow   " << shadowMs << " ms, " << shadowRays << " rays, " << rate(shadowRays, shadowMs) << " Mrays/s"
+        << std::endl;
+}
+
+template <typename MaterialType>
+void Camera::shadePass(const std::vector<int> &queue, PathStates &paths, ShadowQueue &shadows,
+    std::vector<int> &next, int depth) const {
+    /*
+        One bounce of Camera::shade for every path in queue, all of them hitting a MaterialType.
+        scatter and eval are bound at compile time, so the loop body stays the same code.
+        Light samples are queued for the shadow stage instead of traced here.
+    */
+    for (int i : queue) {
+        const MaterialType &mat{ static_cast<const MaterialType &>(MaterialTable::get(paths.recs[i].matId)) };
+        const HitRec &rec{ paths.recs[i] };
+        Sampler &sampler{ paths.samplers[i] };
+        Color &throughput{ paths.throughput[i] };
+        Ray ray{ paths.ray(i) };
+        Color albedo{ albedoOf(mat, rec) };
+        if (depth >= maxDepth) continue;
+
+        bool lightSampled{ directLighting != BSDF_SAMPLING && !mat.SPECULAR && !lights.empty() };
+        paths.lightSampled[i] = lightSampled;
+        if (lightSampled) {
+            Ray shadowRay;
+            Color direct;
+            if (sampleDirectLight(ray, rec, sampler, shadowRay, direct))
+                shadows.push(shadowRay, throughput * albedo * mat.reflectance * direct, i);
+        }
+
+        double &scatterPDF{ paths.scatterPDF[i] };
+        Ray scattered;
+        if constexpr (std::is_same<MaterialType, Material>::value) scattered = mat.scatter(ray, rec, scatterPDF, sampler);
+        else scattered = mat.MaterialType::scatter(ray, rec, scatterPDF, sampler);
+        if (mat.SPECULAR) throughput *= albedo * mat.reflectance;
+        else {
+            if (scatterPDF <= 0.0) continue;
+            double eval;
+            if constexpr (std::is_same<MaterialType, Material>::value) eval = mat.eval(ray, rec, scattered.direction.normalized());
+            else eval = mat.MaterialType::eval(ray, rec, scattered.direction.normalized());
+            throughput *= albedo * (mat.reflectance * eval / scatterPDF);
+        }
+        if (rouletteDepth && depth + 1 >= rouletteDepth) {
+            double survival{ std::min(0.95, std::max(throughput.R, std::max(throughput.G, throughput.B))) };
+            if (sampler.rand01() >= survival) continue;
+            throughput /= survival;
+        }
+        paths.setRay(i, scattered);
+        next.push_back(i);
+    }
+}
+
+void Camera::renderTileWavefront(const Tile &tile, const Primitive &scene, WavefrontStats &stats) {
+    /*
+        Samples of the tile in samplePixel order, wavefrontSize paths per wave. Every path
+        keeps the sampler samplePixel would give it and draws from it in the same order,
+        and pixel sums are taken in sample order, so the image matches the default engine.
+        The exception is Volume, which draws samples for shadow transmittance: its shadow
+        rays are traced after scattering here, before it there.
+    */
+    using Clock = std::chrono::steady_clock;
+    auto milliseconds = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    std::vector<SHADER> shaders(MaterialTable::materials.size());
+    for (size_t m{ 0 }; m < shaders.size(); ++m) shaders[m] = shaderOf(*MaterialTable::materials[m]);
+
+    int spp{ antialiasing * antialiasing };
+    int tileWidth{ tile.x1 - tile.x0 };
+    int total{ tileWidth * (tile.y1 - tile.y0) * spp };
+    double uStep{ 1.0 / resWidth / antialiasing };
+    double vStep{ 1.0 / resHeight / antialiasing };
+    std::vector<Color> sums(tileWidth * (tile.y1 - tile.y0));
+
+    PathStates paths;
+    paths.resize(std::min(std::max(wavefrontSize, 1), total));
+    ShadowQueue shadows;
+    std::vector<int> extend, next;
+    std::vector<int> queues[SHADER_COUNT];
+
+    for (int first{ 0 }; first < total; first += static_cast<int>(paths.samplers.size())) {
+        int count{ std::min(static_cast<int>(paths.samplers.size()), total - first) };
+        ++stats.waves;
+
+        // Generate
+        auto stageStart{ Clock::now() };
+        extend.clear();
+        for (int i{ 0 }; i < count; ++i) {
+            int pixel{ (first + i) / spp }, sample{ (first + i) % spp };
+            int row{ tile.y0 + pixel / tileWidth }, col{ tile.x0 + pixel % tileWidth };
+            int ui{ sample / antialiasing }, vi{ sample % antialiasing };
+            double u{ 1.0 * col / resWidth };
+            double v{ 1.0 * row / resHeight };
+            Sampler &sampler{ paths.samplers[i] };
+            sampler.startPixelSample(row * resWidth + col, ui * antialiasing + vi, frame, seed);
+            paths.setRay(i, getRay(u + ui * uStep, v + vi * vStep, sampler));
+            paths.throughput[i] = Color(1.0);
+            paths.radiance[i] = Color();
+            paths.scatterPDF[i] = 0.0;
+            paths.lightSampled[i] = false;
+            extend.push_back(i);
+        }
+        stats.generateMs += milliseconds(stageStart);
+        stats.cameraRays += count;
+
+        for (int depth{ 0 }; !extend.empty(); ++depth) {
+            // Extend: closest hits, misses collect the background, hits are sorted by shader.
+            stageStart = Clock::now();
+            for (auto &queue : queues) queue.clear();
+            for (int i : extend) {
+                Ray ray{ paths.ray(i) };
+                HitRec &rec{ paths.recs[i] };
+                rec = HitRec();
+                rec.sampler = &paths.samplers[i];
+                if (scene.hit(ray, RAY_EPSILON, 1e10, rec)) {
+                    assert(rec.matId < shaders.size() && "matId is not in MaterialTable");
+                    queues[shaders[rec.matId]].push_back(i);
+                } else paths.radiance[i] += paths.throughput[i] * background(ray);
+            }
+            stats.extendMs += milliseconds(stageStart);
+            stats.extensionRays += static_cast<long long>(extend.size());
+
+            // Shade: lights end their paths, every other pass requeues survivors into next.
+            stageStart = Clock::now();
+            next.clear();
+            shadows.clear();
+            for (int i : queues[LIGHT_SHADER]) {
+                const HitRec &rec{ paths.recs[i] };
+                Ray ray{ paths.ray(i) };
+                if (rec.geometricNormal * ray.direction > 0) continue;
+                Color albedo{ albedoOf(MaterialTable::get(rec.matId), rec) };
+                paths.radiance[i] += paths.throughput[i] * albedo *
+                    emissionWeight(ray, rec, paths.lightSampled[i], paths.scatterPDF[i]);
+            }
+            shadePass<Lambertian>(queues[LAMBERTIAN_SHADER], paths, shadows, next, depth);
+            shadePass<Metal>(queues[METAL_SHADER], paths, shadows, next, depth);
+            shadePass<Dielectric>(queues[DIELECTRIC_SHADER], paths, shadows, next, depth);
+            shadePass<Isotropic>(queues[ISOTROPIC_SHADER], paths, shadows, next, depth);
+            shadePass<Material>(queues[OTHER_SHADER], paths, shadows, next, depth);
+            stats.shadeMs += milliseconds(stageStart);
+
+            // Shadow: light samples count where nothing blocks them.
+            stageStart = Clock::now();
+            for (int k{ 0 }; k < shadows.size(); ++k) {
+                HitRec shadowRec;
+                shadowRec.sampler = &paths.samplers[shadows.path[k]];
+                shadowRec.shadow = true;
+                if (scene.hit(shadows.ray(k), RAY_EPSILON, 1.0 - 0.000001, shadowRec)) continue;
+                Color radiance{ shadows.radiance[k] };
+                if (!volumes.empty()) radiance *= shadowTransmittance(shadows.ray(k), *shadowRec.sampler);
+                paths.radiance[shadows.path[k]] += radiance;
+            }
+            stats.shadowMs += milliseconds(stageStart);
+            stats.shadowRays += shadows.size();
+
+            // Requeue
+            extend.swap(next);
+        }
+
+        for (int i{ 0 }; i < count; ++i) sums[(first + i) / spp] += paths.radiance[i];
+    }
+
+    for (int row{ tile.y0 }; row < tile.y1; ++row) {
+        for (int col{ tile.x0 }; col < tile.x1; ++col) {
+            film.add(col, row, sums[(row - tile.y0) * tileWidth + col - tile.x0], antialiasing * antialiasing);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include "Material.h"
+
+/*
+    State of the wavefront engine (Camera::renderTileWavefront in Wavefront.cpp).
+    Instead of following one path to its end, a whole wave of paths moves one
+    bounce at a time through separate stages:
+        generate: camera rays for every path of the wave
+        extend:   closest hit of every queued ray, then sorted into queues by material
+        shade:    one pass per material type over its queue, scatter and eval bound statically
+        shadow:   occlusion test of the light samples taken while shading
+    Survivors are requeued for the next extend. Every stage is a plain loop over
+    thousands of rays that all run the same code.
+*/
+
+// Which shade pass handles a material. Lights end the path, OTHER_SHADER keeps virtual calls.
+enum SHADER { LAMBERTIAN_SHADER, METAL_SHADER, DIELECTRIC_SHADER, ISOTROPIC_SHADER, LIGHT_SHADER, OTHER_SHADER, SHADER_COUNT };
+SHADER shaderOf(const Material &mat);
+
+struct PathStates {
+    // SoA, one slot per path of the wave. Slots never move, queues hold slot indices.
+    std::vector<Real> ox, oy, oz;
+    std::vector<Real> dx, dy, dz;
+    std::vector<double> time;
+    std::vector<HitRec> recs;
+    std::vector<Color> throughput, radiance;
+    std::vector<double> scatterPDF;
+    std::vector<uint8_t> lightSampled;
+    std::vector<Sampler> samplers;
+
+    void resize(int n);
+    Ray ray(int i) const { return Ray(Vec3(ox[i], oy[i], oz[i]), Vec3(dx[i], dy[i], dz[i]), time[i]); }
+    void setRay(int i, const Ray &ray);
+};
+
+struct ShadowQueue {
+    // Light samples waiting for their occlusion test, radiance is added to path if unblocked.
+    std::vector<Real> ox, oy, oz;
+    std::vector<Real> dx, dy, dz;  // to the light point, which sits at t = 1
+    std::vector<double> time;
+    std::vector<Color> radiance;
+    std::vector<int> path;
+
+    int size() const { return static_cast<int>(path.size()); }
+    void clear();
+    void push(const Ray &ray, const Color &c, int pathIndex);
+    Ray ray(int i) const { return Ray(Vec3(ox[i], oy[i], oz[i]), Vec3(dx[i], dy[i], dz[i]), time[i]); }
+};
+
+struct WavefrontStats {
+    // Summed over threads: milliseconds are busy time of all workers, not wall time.
+    double generateMs{ 0.0 }, extendMs{ 0.0 }, shadeMs{ 0.0 }, shadowMs{ 0.0 };
+    long long waves{ 0 }, cameraRays{ 0 }, extensionRays{ 0 }, shadowRays{ 0 };
+
+    WavefrontStats &operator+=(const WavefrontStats &s);
+    void print() const;
+};
@@ -0,0 +1,117 @@
+#include "WideBVH.h"
+
+template <int W>
+WideBVH<W>::WideBVH(const LinearBVH &bvh) : orderedPrims(bvh.orderedPrims) {
+    box = bvh.box;
+    if (!bvh.nodes.empty()) collapse(bvh, 0);
+}
+
+template <int W>
+int WideBVH<W>::collapse(const LinearBVH &bvh, int binaryIndex) {
+    int index{ static_cast<int>(nodes.size()) };
+    nodes.emplace_back();
+
+    // Gather children by repeatedly opening the largest interior one, until W of them are found.
+    std::vector<int> children;
+    const LinearBVHNode &binaryNode{ bvh.nodes[binaryIndex] };
+    if (binaryNode.primCount) children.push_back(binaryIndex);  // whole tree is a single leaf
+    else children = { binaryIndex + 1, binaryNode.offset };
+    while (static_cast<int>(children.size()) < W) {
+        int best{ -1 };
+        double bestArea{ -1.0 };
+        for (int i{ 0 }; i < static_cast<int>(children.size()); ++i) {
+            const LinearBVHNode &c{ bvh.nodes[children[i]] };
+            if (!c.primCount && c.halfArea() > bestArea) {
+                bestArea = c.halfArea();
+                best = i;
+            }
+        }
+        if (best == -1) break;
+        int opened{ children[best] };
+        children[best] = opened + 1;
+        children.push_back(bvh.nodes[opened].offset);
+    }
+
+    for (int i{ 0 }; i < static_cast<int>(children.size()); ++i) {
+        const LinearBVHNode &c{ bvh.nodes[children[i]] };
+        // Recursion grows nodes, so index into it again instead of holding a reference.
+        int32_t childIndex{ c.primCount ? c.offset : collapse(bvh, children[i]) };
+        WideBVHNode<W> &node{ nodes[index] };
+        node.minX[i] = c.minBound[0]; node.minY[i] = c.minBound[1]; node.minZ[i] = c.minBound[2];
+        node.maxX[i] = c.maxBound[0]; node.maxY[i] = c.maxBound[1]; node.maxZ[i] = c.maxBound[2];
+        node.child[i] = childIndex;
+        node.primCount[i] = c.primCount;
+    }
+    nodes[index].childCount = static_cast<int>(children.size());
+    return index;
+}
+
+template <int W>
+bool WideBVH<W>::hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const {
+    if (nodes.empty()) return false;
+
+    const float origin[3]{
+        static_cast<float>(ray.origin.x), static_cast<float>(ray.origin.y), static_cast<float>(ray.origin.z) };
+    const float dirReciprocal[3]{
+        static_cast<float>(ray.directionReciprocal.x),
+        static_cast<float>(ray.directionReciprocal.y),
+        static_cast<float>(ray.directionReciprocal.z) };
+    const int dirIsNeg[3]{ !ray.xPositive, !ray.yPositive, !ray.zPositive };
+    float tMinF{ static_cast<float>(tMin) };
+
+    struct Entry {
+        int32_t child;
+        uint16_t primCount;
+        float tNear;
+    };
+    // Every level pushes at most W - 1 siblings.
+    Entry stack[64 * W];
+    int stackSize{ 0 };
+    stack[stackSize++] = { 0, 0, tMinF };
+    bool hitAnything{ false };
+
+    while (stackSize) {
+        const Entry entry{ stack[--stackSize] };
+        // A closer hit was found since this entry was pushed.
+        if (entry.tNear > tMax) continue;
+
+        if (entry.primCount) {
+            for (int i{ 0 }; i < entry.primCount; ++i) {
+                if (orderedPrims[entry.child + i]->hit(ray, tMin, tMax, rec)) {
+                    hitAnything = true;
+                    tMax = rec.t;
+                }
+            }
+            continue;
+        }
+
+        const WideBVHNode<W> &node{ nodes[entry.child] };
+        float tNear[W];
+        int mask{ node.hit(origin, dirReciprocal, dirIsNeg, tMinF, static_cast<float>(tMax), tNear) };
+
+        // Sort hit children far to near, so the nearest is popped first.
+        Entry hits[W];
+        int hitCount{ 0 };
+        for (int i{ 0 }; i < W; ++i) {
+            if (!(mask >> i & 1)) continue;
+            Entry e{ node.child[i], node.primCount[i], tNear[i] };
+            int j{ hitCount++ };
+            for (; j > 0 && hits[j - 1].tNear < e.tNear; --j) hits[j] = hits[j - 1];
+            hits[j] = e;
+        }
+        for (int i{ 0 }; i < hitCount; ++i) stack[stackSize++] = hits[i];
+    }
+    return hitAnything;
+}
+
+template <int W>
+void WideBVH<W>::printSelf() const {
+    int childSum{ 0 };
+    for (const auto &node : nodes) childSum += node.childCount;
+    std::cout << "BVH" << W << ": " << nodes.size() << " nodes, "
+        << (nodes.empty() ? 0.0 : 1.0 * childSum / nodes.size()) << " children per node, "
+        << nodes.size() * sizeof(WideBVHNode<W>) << " bytes" << std::endl;
+}
+
+template struct WideBVH<4>;
+template struct WideBVH<8>;
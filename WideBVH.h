@@ -0,0 +1,147 @@
+#pragma once
+
+#include "LinearBVH.h"
+#include "SIMD.h"
+
+template <int W>
+struct alignas(32) WideBVHNode {
+    // Bounds of all W children in SoA form, so one SIMD sequence tests a ray against every child.
+    // Unused slots keep inverted (empty) bounds and can never be hit.
+    float minX[W], minY[W], minZ[W];
+    float maxX[W], maxY[W], maxZ[W];
+    int32_t child[W];  // interior child: node index. leaf child: first primitive in orderedPrims
+    uint16_t primCount[W];  // 0 for interior child
+    int childCount{ 0 };
+
+    WideBVHNode();
+    // Bit i is set if child i is hit, its entry distance is written to tNear[i].
+    int hit(const float origin[3], const float dirReciprocal[3], const int dirIsNeg[3],
+        float tMin, float tMax, float tNear[W]) const;
+};
+
+template <int W>
+struct WideBVH : public Primitive {
+    // BVH4 / BVH8: binary LinearBVH collapsed so every node holds up to W children.
+    // Children are traversed front to back by their entry distance.
+    // Primitives are not owned, the prims vector used for building must outlive this.
+    std::vector<WideBVHNode<W>> nodes;
+    std::vector<const Primitive *> orderedPrims;
+
+    WideBVH() = default;
+    WideBVH(const LinearBVH &bvh);
+
+    bool hit(const Ray &ray, double tMin, double tMax, HitRec &rec) const override;
+    void makeAABB() override {}
+    virtual void printSelf() const override;
+    virtual Vec2 uv(const Vec3 &p) const override { return Vec2(); }
+    virtual void transform(const Transformation &trans) override {}
+
+private:
+    int collapse(const LinearBVH &bvh, int binaryIndex);
+};
+
+using BVH4 = WideBVH<4>;
+using BVH8 = WideBVH<8>;
+
+template <int W>
+inline WideBVHNode<W>::WideBVHNode() {
+    for (int i{ 0 }; i < W; ++i) {
+        minX[i] = minY[i] = minZ[i] = INFINITY;
+        maxX[i] = maxY[i] = maxZ[i] = -INFINITY;
+        child[i] = -1;
+        primCount[i] = 0;
+    }
+}
+
+template <int W>
+inline int WideBVHNode<W>::hit(
+    const float origin[3], const float dirReciprocal[3], const int dirIsNeg[3],
+    float tMin, float tMax, float tNear[W]) const {
+    // Scalar fallback, laid out so the compiler can still vectorize it.
+    const float *nearX{ dirIsNeg[0] ? maxX : minX }, *farX{ dirIsNeg[0] ? minX : maxX };
+    const float *nearY{ dirIsNeg[1] ? maxY : minY }, *farY{ dirIsNeg[1] ? minY : maxY };
+    const float *nearZ{ dirIsNeg[2] ? maxZ : minZ }, *farZ{ dirIsNeg[2] ? minZ : maxZ };
+    int mask{ 0 };
+    for (int i{ 0 }; i < W; ++i) {
+        float t0{ std::max(std::max((nearX[i] - origin[0]) * dirReciprocal[0],
+            (nearY[i] - origin[1]) * dirReciprocal[1]),
+            std::max((nearZ[i] - origin[2]) * dirReciprocal[2], tMin)) };
+        float t1{ std::min(std::min((farX[i] - origin[0]) * dirReciprocal[0],
+            (farY[i] - origin[1]) * dirReciprocal[1]),
+            std::min((farZ[i] - origin[2]) * dirReciprocal[2], tMax)) };
+        tNear[i] = t0;
+        mask |= (t0 <= t1 * 1.0000004f) << i;
+    }
+    return mask;
+}
+
+#if PBRT_SSE
+inline int slabTest4(
+    const float *nearX, const float *nearY, const float *nearZ,
+    const float *farX, const float *farY, const float *farZ,
+    const float origin[3], const float dirReciprocal[3], float tMin, float tMax, float tNear[4]) {
+    // Four boxes against one ray, near/far planes already chosen by direction sign.
+    const __m128 ox{ _mm_set1_ps(origin[0]) }, oy{ _mm_set1_ps(origin[1]) }, oz{ _mm_set1_ps(origin[2]) };
+    const __m128 idx{ _mm_set1_ps(dirReciprocal[0]) };
+    const __m128 idy{ _mm_set1_ps(dirReciprocal[1]) };
+    const __m128 idz{ _mm_set1_ps(dirReciprocal[2]) };
+    __m128 t0x{ _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearX), ox), idx) };
+    __m128 t0y{ _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearY), oy), idy) };
+    __m128 t0z{ _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearZ), oz), idz) };
+    __m128 t1x{ _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farX), ox), idx) };
+    __m128 t1y{ _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farY), oy), idy) };
+    __m128 t1z{ _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farZ), oz), idz) };
+    __m128 t0{ _mm_max_ps(_mm_max_ps(t0x, t0y), _mm_max_ps(t0z, _mm_set1_ps(tMin))) };
+    __m128 t1{ _mm_min_ps(_mm_min_ps(t1x, t1y), _mm_min_ps(t1z, _mm_set1_ps(tMax))) };
+    _mm_storeu_ps(tNear, t0);
+    return _mm_movemask_ps(_mm_cmple_ps(t0, _mm_mul_ps(t1, _mm_set1_ps(1.0000004f))));
+}
+
+template <>
+inline int WideBVHNode<4>::hit(
+    const float origin[3], const float dirReciprocal[3], const int dirIsNeg[3],
+    float tMin, float tMax, float tNear[4]) const {
+    return slabTest4(
+        dirIsNeg[0] ? maxX : minX, dirIsNeg[1] ? maxY : minY, dirIsNeg[2] ? maxZ : minZ,
+        dirIsNeg[0] ? minX : maxX, dirIsNeg[1] ? minY : maxY, dirIsNeg[2] ? minZ : maxZ,
+        origin, dirReciprocal, tMin, tMax, tNear);
+}
+
+#if !PBRT_AVX
+template <>
+inline int WideBVHNode<8>::hit(
+    const float origin[3], const float dirReciprocal[3], const int dirIsNeg[3],
+    float tMin, float tMax, float tNear[8]) const {
+    // No AVX: two SSE halves.
+    const float *nearX{ dirIsNeg[0] ? maxX : minX }, *farX{ dirIsNeg[0] ? minX : maxX };
+    const float *nearY{ dirIsNeg[1] ? maxY : minY }, *farY{ dirIsNeg[1] ? minY : maxY };
+    const float *nearZ{ dirIsNeg[2] ? maxZ : minZ }, *farZ{ dirIsNeg[2] ? minZ : maxZ };
+    int low{ slabTest4(nearX, nearY, nearZ, farX, farY, farZ, origin, dirReciprocal, tMin, tMax, tNear) };
+    int high{ slabTest4(nearX + 4, nearY + 4, nearZ + 4, farX + 4, farY + 4, farZ + 4,
+        origin, dirReciprocal, tMin, tMax, tNear + 4) };
+    return low | high << 4;
+}
+#endif
+#endif
+
+#if PBRT_AVX
+template <>
+inline int WideBVHNode<8>::hit(
+    const float origin[3], const float dirReciprocal[3], const int dirIsNeg[3],
+    float tMin, float tMax, float tNear[8]) const {
+    const __m256 ox{ _mm256_set1_ps(origin[0]) }, oy{ _mm256_set1_ps(origin[1]) }, oz{ _mm256_set1_ps(origin[2]) };
+    const __m256 idx{ _mm256_set1_ps(dirReciprocal[0]) };
+    const __m256 idy{ _mm256_set1_ps(dirReciprocal[1]) };
+    const __m256 idz{ _mm256_set1_ps(dirReciprocal[2]) };
+    __m256 t0x{ _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dirIsNeg[0] ? maxX : minX), ox), idx) };
+    __m256 t0y{ _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dirIsNeg[1] ? maxY : minY), oy), idy) };
+    __m256 t0z{ _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dirIsNeg[2] ? maxZ : minZ), oz), idz) };
+    __m256 t1x{ _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dirIsNeg[0] ? minX : maxX), ox), idx) };
+    __m256 t1y{ _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dirIsNeg[1] ? minY : maxY), oy), idy) };
+    __m256 t1z{ _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(dirIsNeg[2] ? minZ : maxZ), oz), idz) };
+    __m256 t0{ _mm256_max_ps(_mm256_max_ps(t0x, t0y), _mm256_max_ps(t0z, _mm256_set1_ps(tMin))) };
+    __m256 t1{ _mm256_min_ps(_mm256_min_ps(t1x, t1y), _mm256_min_ps(t1z, _mm256_set1_ps(tMax))) };
+    _mm256_storeu_ps(tNear, t0);
+    return _mm256_movemask_ps(_mm256_cmp_ps(t0, _mm256_mul_ps(t1, _mm256_set1_ps(1.0000004f)), _CMP_LE_OQ));
+}
+#endif
@@ -0,0 +1,301 @@
+// Microbenchmarks for the intersection and sampling kernels.
+// Build together with every .cpp of the project except main.cpp, e.g.
+//     g++ -O2 -std=c++17 -mavx2 -I.. benchmark.cpp $(ls ../*.cpp | grep -v main.cpp) -o benchmark -lpthread
+// Usage: benchmark [filter], only benchmarks whose name contains filter are run.
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../Camera.h"
+#include "../Geometry.h"
+#include "../imageIO.h"
+
+struct Benchmark {
+    /*
+        Runs a kernel over and over until minMilliseconds have passed, then reports
+        time per operation and operations per second. For ray kernels an operation
+        is one ray, so ops/s reads as rays/s.
+    */
+    std::string filter;
+    double minMilliseconds{ 300.0 };
+
+    template <typename Kernel>
+    void run(const std::string &name, const std::string &unit, long long opsPerCall, const Kernel &kernel) const {
+        if (!filter.empty() && name.find(filter) == std::string::npos) return;
+        kernel();  // warm up caches and lazily built state
+        long long calls{ 0 };
+        auto start{ std::chrono::steady_clock::now() };
+        double elapsed{ 0.0 };
+        do {
+            kernel();
+            ++calls;
+            elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < minMilliseconds);
+        double ops{ 1.0 * calls * opsPerCall };
+        std::printf("%-32s %12.2f ns/op %14.0f %s/s\n", name.c_str(), elapsed * 1e6 / ops, ops / elapsed * 1e3, unit.c_str());
+    }
+};
+
+// Keeps results alive so the compiler cannot drop the benchmarked work.
+static volatile double sink{ 0.0 };
+
+static std::vector<Ray> makeRays(int count, const Vec3 &target, double spread, uint64_t seed) {
+    // Fixed ray set: origins on a sphere of radius 30 around target, aimed at target with some spread.
+    Sampler sampler(seed);
+    std::vector<Ray> rays;
+    rays.reserve(count);
+    for (int i{ 0 }; i < count; ++i) {
+        Vec3 origin{ sampler.rand01() * 2.0 - 1.0, sampler.rand01() * 2.0 - 1.0, sampler.rand01() * 2.0 - 1.0 };
+        origin = target + origin.normalized() * 30.0;
+        Vec3 aim{ target + Vec3(sampler.rand01() - 0.5, sampler.rand01() - 0.5, sampler.rand01() - 0.5) * spread };
+        rays.emplace_back(origin, aim - origin);
+    }
+    return rays;
+}
+
+template <typename PrimitiveType>
+static void benchHit(const Benchmark &bench, const std::string &name, const PrimitiveType &prim, const std::vector<Ray> &rays) {
+    bench.run(name, "rays", static_cast<long long>(rays.size()), [&]() {
+        HitRec rec;
+        Sampler sampler;
+        rec.sampler = &sampler;
+        int hits{ 0 };
+        for (const auto &ray : rays) hits += prim.hit(ray, 0.0000001, 1e10, rec);
+        sink = sink + hits;
+    });
+}
+
+static std::vector<primPointer> makeScene(int triangles, int spheres, uint64_t seed) {
+    // Random triangles and spheres inside a 20 * 20 * 20 box around the origin.
+    Sampler sampler(seed);
+    auto randomPoint = [&](double scale) {
+        return Vec3(sampler.rand01() - 0.5, sampler.rand01() - 0.5, sampler.rand01() - 0.5) * scale;
+    };
+    uint32_t matId{ MaterialTable::add(Lambertian(WHITE)) };
+    std::vector<primPointer> prims;
+    for (int i{ 0 }; i < triangles; ++i) {
+        Vec3 center{ randomPoint(20.0) };
+        prims.push_back(std::make_shared<Triangle>(Triangle(
+            center + randomPoint(1.0), center + randomPoint(1.0), center + randomPoint(1.0),
+            Vec2(), Vec2(), Vec2(), matId)));
+    }
+    for (int i{ 0 }; i < spheres; ++i) {
+        auto sphere = std::make_shared<Sphere>(Sphere(0.2 + sampler.rand01() * 0.3, matId));
+        sphere->transform(Transformation(Transformation::T,
+            sampler.rand01() * 20 - 10, sampler.rand01() * 20 - 10, sampler.rand01() * 20 - 10));
+        prims.push_back(sphere);
+    }
+    for (auto &prim : prims) prim->makeAABB();
+    return prims;
+}
+
+int main(int argc, char **argv) {
+    Benchmark bench;
+    if (argc > 1) bench.filter = argv[1];
+
+    std::printf("%-32s %15s %17s\n", "benchmark", "time", "throughput");
+    const std::vector<Ray> rays{ makeRays(1 << 14, Vec3(), 4.0, 1) };
+
+    // Single primitives, about half of the rays hit.
+    {
+        AABB box(Vec3(-1.0), Vec3(1.0));
+        bench.run("AABB::hit", "rays", static_cast<long long>(rays.size()), [&]() {
+            int hits{ 0 };
+            for (const auto &ray : rays) hits += box.hit(ray, 0.0000001, 1e10);
+            sink = sink + hits;
+        });
+
+        Sphere sphere(1.5, Lambertian(WHITE));
+        sphere.makeAABB();
+        benchHit(bench, "Sphere::hit", sphere, rays);
+
+        Triangle triangle(Vec3(-2, -2, 0), Vec3(2, -2, 0), Vec3(0, 2, 0), Vec2(), Vec2(), Vec2(), Lambertian(WHITE));
+        triangle.makeAABB();
+        benchHit(bench, "Triangle::hit", triangle, rays);
+
+        Volume volume(3.0, 3.0, 3.0, 0.5);
+        volume.transform(Transformation());
+        volume.makeAABB();
+        benchHit(bench, "Volume::hit", volume, rays);
+
+        Volume fog(3.0, 3.0, 3.0, std::make_shared<TextureDensity>(PerlinNoise(1.0, false, 4), 0.5));
+        fog.transform(Transformation());
+        fog.makeAABB();
+        benchHit(bench, "Volume::hit Perlin density", fog, rays);
+    }
+
+    // Acceleration structures over 100k primitives.
+    {
+        MaterialTable::clear();  // every scene registers its own materials
+        std::vector<primPointer> prims{ makeScene(90000, 10000, 2) };
+        const std::vector<Ray> sceneRays{ makeRays(1 << 14, Vec3(), 20.0, 3) };
+        const long long primCount{ static_cast<long long>(prims.size()) };
+
+        bench.run("BVH build sorted SAH", "prims", primCount, [&]() {
+            std::vector<primPointer> copy{ prims };
+            BVH bvh(copy, copy.begin(), copy.end());
+            sink = sink + bvh.box.area;
+        });
+        bench.run("LinearBVH build binned SAH", "prims", primCount, [&]() {
+            LinearBVH bvh(prims);
+            sink = sink + bvh.nodes.size();
+        });
+
+        BVH bvh(prims, prims.begin(), prims.end());
+        LinearBVH linearBVH(prims);
+        BVH4 bvh4(linearBVH);
+        BVH8 bvh8(linearBVH);
+        benchHit(bench, "BVH::hit", bvh, sceneRays);
+        benchHit(bench, "LinearBVH::hit", linearBVH, sceneRays);
+        benchHit(bench, "BVH4::hit", bvh4, sceneRays);
+        benchHit(bench, "BVH8::hit", bvh8, sceneRays);
+    }
+
+    // Motion blur: 1000 small spheres, every other one moving far during the interval.
+    // BVH8 only has the union bounds over the interval, LinearBVH interpolates by ray time.
+    {
+        MaterialTable::clear();
+        Primitive::timeStart = 0.0;
+        Primitive::timeEnd = 1.0;
+        Sampler sampler(6);
+        std::vector<primPointer> prims;
+        for (int i{ 0 }; i < 1000; ++i) {
+            Vec3 velocity{ i % 2 ? Vec3(sampler.rand01() - 0.5, 0.0, sampler.rand01() - 0.5) * 20.0 : Vec3() };
+            auto sphere = std::make_shared<Sphere>(Sphere(0.15, Lambertian(WHITE), velocity));
+            sphere->moving = i % 2;
+            sphere->transform(Transformation(Transformation::T,
+                sampler.rand01() * 16 - 8, sampler.rand01() * 4 - 2, sampler.rand01() * 16 - 8));
+            sphere->makeAABB();
+            prims.push_back(sphere);
+        }
+        std::vector<Ray> motionRays{ makeRays(1 << 14, Vec3(), 16.0, 7) };
+        for (auto &ray : motionRays) ray.time = sampler.rand01();
+        LinearBVH linearBVH(prims);
+        BVH8 bvh8(linearBVH);
+        benchHit(bench, "LinearBVH::hit moving spheres", linearBVH, motionRays);
+        benchHit(bench, "BVH8::hit moving spheres", bvh8, motionRays);
+    }
+
+    // Dense mesh: bumpy sphere of 262k triangles, by mesh leaf size.
+    {
+        MaterialTable::clear();
+        const int rings{ 256 }, segments{ 512 };
+        TriangleMesh mesh{ Lambertian(WHITE) };
+        for (int r{ 0 }; r <= rings; ++r) {
+            for (int s{ 0 }; s < segments; ++s) {
+                double theta{ PI * r / rings }, phi{ 2.0 * PI * s / segments };
+                double radius{ 5.0 + 0.2 * std::sin(theta * 40.0) * std::sin(phi * 40.0) };
+                mesh.px.push_back(static_cast<float>(radius * std::sin(theta) * std::cos(phi)));
+                mesh.py.push_back(static_cast<float>(radius * std::cos(theta)));
+                mesh.pz.push_back(static_cast<float>(radius * std::sin(theta) * std::sin(phi)));
+            }
+        }
+        for (uint32_t r{ 0 }; r < rings; ++r) {
+            for (uint32_t s{ 0 }; s < segments; ++s) {
+                uint32_t a{ r * segments + s }, b{ r * segments + (s + 1) % segments };
+                uint32_t c{ a + segments }, d{ b + segments };
+                mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+            }
+        }
+        const std::vector<Ray> meshRays{ makeRays(1 << 14, Vec3(), 8.0, 5) };
+        for (int leafSize : { 2, 4, 8 }) {
+            mesh.maxLeafSize = leafSize;
+            mesh.makeAABB();
+            benchHit(bench, "TriangleMesh::hit leaf " + std::to_string(leafSize), mesh, meshRays);
+        }
+
+        // The same mesh behind an instance transform.
+        auto prototype{ std::make_shared<Prototype>(std::vector<primPointer>{ std::make_shared<TriangleMesh>(mesh) }) };
+        Instance instance(prototype);
+        instance.transform(Transformation(Transformation::RY, 30));
+        instance.makeAABB();
+        benchHit(bench, "Instance::hit mesh", instance, meshRays);
+    }
+
+    // Sampling and shading kernels.
+    {
+        MaterialTable::clear();
+        Lambertian lambertian(WHITE);
+        Vec3 normal{ Vec3(0.3, 1.0, 0.2).normalized() };
+        Sampler sampler(4);
+        bench.run("randomSampleInHemiSphere", "samples", 1 << 14, [&]() {
+            double sum{ 0.0 };
+            for (int i{ 0 }; i < 1 << 14; ++i) {
+                double cosTheta;
+                sum += lambertian.randomSampleInHemiSphere(normal, cosTheta, sampler).y;
+            }
+            sink = sink + sum;
+        });
+
+        // One path vertex of Lambertian + ConstantTexture: albedo, scatter and eval.
+        const Material &mat{ MaterialTable::get(MaterialTable::add(Lambertian(WHITE))) };
+        HitRec rec;
+        rec.normal = normal;
+        const Ray rayIn(Vec3(0.0, 1.0, 0.0), -normal);
+        bench.run("shade vertex virtual", "vertices", 1 << 14, [&]() {
+            double sum{ 0.0 };
+            for (int i{ 0 }; i < 1 << 14; ++i) {
+                double PDF;
+                Color albedo{ mat.texture->v(rec.uv, rec.p) };
+                Ray scattered{ mat.scatter(rayIn, rec, PDF, sampler) };
+                sum += albedo.R * mat.eval(rayIn, rec, scattered.direction) / PDF;
+            }
+            sink = sink + sum;
+        });
+        bench.run("shade vertex switch dispatch", "vertices", 1 << 14, [&]() {
+            double sum{ 0.0 };
+            for (int i{ 0 }; i < 1 << 14; ++i) {
+                double PDF;
+                Color albedo{ albedoOf(mat, rec) };
+                Ray scattered{ scatterOf(mat, rayIn, rec, PDF, sampler) };
+                sum += albedo.R * evalOf(mat, rayIn, rec, scattered.direction) / PDF;
+            }
+            sink = sink + sum;
+        });
+
+        PerlinNoise noise(4.0, false, 4, 2.0, 0.5, Vec3(), sampler);
+        bench.run("PerlinNoise::v", "lookups", 1 << 14, [&]() {
+            double sum{ 0.0 };
+            for (int i{ 0 }; i < 1 << 14; ++i) sum += noise.v(Vec2(), Vec3(i * 0.013, i * 0.007, i * 0.011)).R;
+            sink = sink + sum;
+        });
+
+        std::vector<uint8_t> rgb(2048 * 2048 * 3);
+        for (auto &byte : rgb) byte = static_cast<uint8_t>(sampler.rand01() * 256.0);
+        ImageTexture texture(2048, 2048, rgb);
+        std::vector<Vec2> uvs(1 << 14);
+        for (auto &uv : uvs) uv = Vec2(sampler.rand01(), sampler.rand01());
+        bench.run("ImageTexture::v 2048x2048", "lookups", 1 << 14, [&]() {
+            double sum{ 0.0 };
+            for (const auto &uv : uvs) sum += texture.v(uv, Vec3()).R;
+            sink = sink + sum;
+        });
+
+        Transformation trans{ Transformation(Transformation::RX, 30) * Transformation(Transformation::RY, 45) *
+            Transformation(Transformation::T, 1, 2, 3) };
+        bench.run("Transformation::inverted", "matrices", 1024, [&]() {
+            double sum{ 0.0 };
+            for (int i{ 0 }; i < 1024; ++i) sum += trans.inverted().components[3];
+            sink = sink + sum;
+        });
+
+        Film film(512, 512);
+        for (int y{ 0 }; y < 512; ++y)
+            for (int x{ 0 }; x < 512; ++x) film.set(x, y, Color(0.5, 0.25, 0.75));
+        ImageView image{ film.view() };
+        // outputPic reports progress on std::cout, mute it while timing.
+        std::streambuf *coutBuffer{ std::cout.rdbuf(nullptr) };
+        bench.run("outputPic QOI 512x512", "pixels", 512 * 512, [&]() {
+            outputPic("benchmark_output", PIC_FORMAT::QOI, image);
+        });
+        bench.run("outputPic PPM 512x512", "pixels", 512 * 512, [&]() {
+            outputPic("benchmark_output", PIC_FORMAT::PPM, image);
+        });
+        bench.run("outputPic PFM 512x512", "pixels", 512 * 512, [&]() {
+            outputPic("benchmark_output", PIC_FORMAT::PFM, image);
+        });
+        std::cout.rdbuf(coutBuffer);
+        std::cout.clear();
+    }
+    return 0;
+}
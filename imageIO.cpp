@@ -2,56 +2,193 @@
 #include "qoi.h"
 #include <iostream>
 #include <fstream>
+#include <chrono>
+#include <cstring>
 #include "imageIO.h"
 
-void outputPic(
-    const std::string &filename,
-    const PIC_FORMAT &f,
-    const std::vector<std::vector<Color>> &pixels
-) {
-    int height{ static_cast<int>(pixels.size()) };
-    int width{ static_cast<int>(pixels[0].size()) };
-    
-    if (f == PIC_FORMAT::PPM) {
-        std::cout << "Start writing PPM file." << std::endl;
-        std::ofstream picOut;
-        picOut.open(filename + ".ppm", 'w');
-        picOut << "P3\n" << width << " " << height << "\n255\n";
-        for (int row{ 0 }; row < height; ++row) {
-            std::cout << "\rWriting ROW " << row + 1 << " of " << height << " .";
-            for (int col{ 0 }; col < width; ++col) {
-                const Color &pxl = pixels[row][col];
-                picOut << pxl;
+namespace {
+
+uint8_t toByte(double channel) {
+    return static_cast<uint8_t>(255.99 * (channel <= 1.0 ? (channel > 0.0 ? channel : 0.0) : 1.0));
+}
+
+struct QOIStream {
+    // qoi_encode carried across calls, so rows can be encoded one at a time.
+    qoi_rgba_t index[64];
+    qoi_rgba_t previous;
+    int run{ 0 };
+
+    QOIStream() {
+        QOI_ZEROARR(index);
+        previous.v = 0;
+        previous.rgba.a = 255;
+    }
+    void header(std::vector<char> &bytes, int width, int height) const;
+    void encode(const ImageView &image, int row, std::vector<char> &bytes);
+    void end(std::vector<char> &bytes) const { bytes.insert(bytes.end(), qoi_padding, qoi_padding + sizeof(qoi_padding)); }
+};
+
+void QOIStream::header(std::vector<char> &bytes, int width, int height) const {
+    unsigned char h[QOI_HEADER_SIZE];
+    int p{ 0 };
+    qoi_write_32(h, &p, QOI_MAGIC);
+    qoi_write_32(h, &p, width);
+    qoi_write_32(h, &p, height);
+    h[p++] = 3;
+    h[p++] = QOI_SRGB;
+    bytes.insert(bytes.end(), h, h + p);
+}
+
+void QOIStream::encode(const ImageView &image, int row, std::vector<char> &bytes) {
+    // Same choice of ops as qoi_encode for 3 channels, so the file matches qoi_write byte for byte.
+    bool lastRow{ row == image.height - 1 };
+    for (int col{ 0 }; col < image.width; ++col) {
+        Color c{ image(col, row) };
+        qoi_rgba_t px{ previous };
+        px.rgba.r = toByte(c.R);
+        px.rgba.g = toByte(c.G);
+        px.rgba.b = toByte(c.B);
+
+        if (px.v == previous.v) {
+            ++run;
+            if (run == 62 || (lastRow && col == image.width - 1)) {
+                bytes.push_back(static_cast<char>(QOI_OP_RUN | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            bytes.push_back(static_cast<char>(QOI_OP_RUN | (run - 1)));
+            run = 0;
+        }
+        int indexPos{ QOI_COLOR_HASH(px) % 64 };
+        if (index[indexPos].v == px.v) bytes.push_back(static_cast<char>(QOI_OP_INDEX | indexPos));
+        else {
+            index[indexPos] = px;
+            signed char vr = px.rgba.r - previous.rgba.r;
+            signed char vg = px.rgba.g - previous.rgba.g;
+            signed char vb = px.rgba.b - previous.rgba.b;
+            signed char vgr = vr - vg;
+            signed char vgb = vb - vg;
+            if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                bytes.push_back(static_cast<char>(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+            else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+                bytes.push_back(static_cast<char>(QOI_OP_LUMA | (vg + 32)));
+                bytes.push_back(static_cast<char>((vgr + 8) << 4 | (vgb + 8)));
+            }
+            else {
+                bytes.push_back(static_cast<char>(QOI_OP_RGB));
+                bytes.push_back(static_cast<char>(px.rgba.r));
+                bytes.push_back(static_cast<char>(px.rgba.g));
+                bytes.push_back(static_cast<char>(px.rgba.b));
             }
         }
-        picOut.close();
-        std::cout << "\nPPM output finished." << std::endl;
+        previous = px;
+    }
+}
+
+}
+
+ImageWriter::ImageWriter(const std::string &filename, PIC_FORMAT f, const ImageView &view) :
+    format(f), image(view), width(view.width), height(view.height) {
+    if (!width || !height) throw "Cannot write an empty image.";
+    path = filename + (f == PIC_FORMAT::PPM ? ".ppm" : (f == PIC_FORMAT::QOI ? ".qoi" : ".pfm"));
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw "Cannot open image file for writing.";
+    pixelsDone.assign(height, 0);
+    writer = std::thread(&ImageWriter::writeRows, this);
+}
+
+void ImageWriter::tileDone(int x0, int y0, int x1, int y1) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int row{ y0 }; row < y1; ++row) pixelsDone[row] += x1 - x0;
+        if (rowsReady >= y1 || pixelsDone[rowsReady] < width) return;
+        while (rowsReady < height && pixelsDone[rowsReady] >= width) ++rowsReady;
     }
+    rowsDone.notify_one();
+}
+
+double ImageWriter::finish() {
+    if (!writer.joinable()) return 0.0;
+    auto waitStart{ std::chrono::steady_clock::now() };
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        rowsReady = height;
+    }
+    rowsDone.notify_one();
+    writer.join();
+    file.close();
+    if (file.fail()) std::cout << "Writing " << path << " failed." << std::endl;
+    else std::cout << path << " written." << std::endl;
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+}
+
+void ImageWriter::writeRows() {
+    std::vector<char> bytes;
+    QOIStream qoi;
+    size_t pfmHeader{ 0 };
+    if (format == PIC_FORMAT::PPM) {
+        std::string header{ "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n" };
+        bytes.assign(header.begin(), header.end());
+    }
+    else if (format == PIC_FORMAT::QOI) qoi.header(bytes, width, height);
+    else {
+        // A negative scale marks little endian floats.
+        const uint16_t one{ 1 };
+        bool littleEndian{ *reinterpret_cast<const uint8_t *>(&one) == 1 };
+        std::string header{ "PF\n" + std::to_string(width) + " " + std::to_string(height) + (littleEndian ? "\n-1.0\n" : "\n1.0\n") };
+        bytes.assign(header.begin(), header.end());
+        pfmHeader = bytes.size();
+    }
+    file.write(bytes.data(), bytes.size());
 
-    if (f == PIC_FORMAT::QOI) {
-        std::cout << "Write QOI file." << std::endl;
-
-        // Serialization
-        char *rgb_pixels = new char[width * height * 3];
-        for (int row{ 0 }; row < height; ++row) {
-            for (int col{ 0 }; col < width; ++col) {
-                const Color &pxl = pixels[row][col];
-                rgb_pixels[row * width * 3 + col * 3] = pxl.d2c(pxl.R);
-                rgb_pixels[row * width * 3 + col * 3 + 1] = pxl.d2c(pxl.G);
-                rgb_pixels[row * width * 3 + col * 3 + 2] = pxl.d2c(pxl.B);
+    for (int row{ 0 }; row < height;) {
+        int ready;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            rowsDone.wait(lock, [&] { return rowsReady > row; });
+            ready = rowsReady;
+        }
+        for (; row < ready; ++row) {
+            bytes.clear();
+            if (format == PIC_FORMAT::PPM) {
+                bytes.resize(static_cast<size_t>(width) * 3);
+                for (int col{ 0 }; col < width; ++col) {
+                    Color c{ image(col, row) };
+                    bytes[col * 3] = static_cast<char>(toByte(c.R));
+                    bytes[col * 3 + 1] = static_cast<char>(toByte(c.G));
+                    bytes[col * 3 + 2] = static_cast<char>(toByte(c.B));
+                }
+            }
+            else if (format == PIC_FORMAT::QOI) {
+                qoi.encode(image, row, bytes);
+                if (row == height - 1) qoi.end(bytes);
             }
+            else {
+                // PFM stores rows bottom to top, each goes to its place in the file.
+                bytes.resize(static_cast<size_t>(width) * 3 * sizeof(float));
+                for (int col{ 0 }; col < width; ++col) {
+                    Color c{ image(col, row) };
+                    float rgb[3]{ static_cast<float>(c.R), static_cast<float>(c.G), static_cast<float>(c.B) };
+                    std::memcpy(&bytes[col * sizeof(rgb)], rgb, sizeof(rgb));
+                }
+                file.seekp(static_cast<std::streamoff>(pfmHeader + static_cast<size_t>(height - 1 - row) * bytes.size()));
+            }
+            file.write(bytes.data(), bytes.size());
         }
-
-        qoi_desc desc;
-        desc.width = width;
-        desc.height = height;
-        desc.channels = 3;
-        desc.colorspace = QOI_SRGB;
-        qoi_write((filename + ".qoi").c_str(), rgb_pixels, &desc);
-        delete[]rgb_pixels;
     }
 }
 
+void outputPic(
+    const std::string &filename,
+    const PIC_FORMAT &f,
+    const ImageView &image
+) {
+    ImageWriter writer(filename, f, image);
+    writer.finish();
+}
+
 void inputQOI(const std::string &filename, std::vector<std::vector<Color>> &pixels) {
     qoi_desc desc;
     void *rawData = qoi_read((filename + ".qoi").c_str(), &desc, 3);
@@ -68,4 +205,15 @@ void inputQOI(const std::string &filename, std::vector<std::vector<Color>> &pixe
         }
     }
     free(rawData);
-}
\ No newline at end of file
+}
+
+void inputQOI(const std::string &filename, int &width, int &height, std::vector<uint8_t> &rgb) {
+    qoi_desc desc;
+    void *rawData = qoi_read((filename + ".qoi").c_str(), &desc, 3);
+    if (!rawData) throw "Cannot read QOI file.";
+    unsigned char *pixelData = static_cast<unsigned char*>(rawData);
+    width = desc.width;
+    height = desc.height;
+    rgb.assign(pixelData, pixelData + static_cast<size_t>(width) * height * 3);
+    free(rawData);
+}
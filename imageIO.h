@@ -1,14 +1,61 @@
 #pragma once
 #include <vector>
 #include <string>
-#include "Color.h"
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "Film.h"
 
-enum class PIC_FORMAT { PPM, QOI };
+// PPM: binary P6, QOI: 8-bit RGB, both clamped to [0, 1]. PFM: 32-bit float RGB, unclamped.
+enum class PIC_FORMAT { PPM, QOI, PFM };
 
+struct ImageWriter {
+    /*
+        Writes an image while it is being rendered. The renderer reports every finished
+        tile, and a background thread encodes each row as soon as all of its pixels are
+        done, top to bottom, reading them straight through the view. Only the encoded
+        bytes of one row are held at a time. The viewed image must outlive finish().
+    */
+    ImageWriter(const std::string &filename, PIC_FORMAT f, const ImageView &image);
+    ImageWriter(const ImageWriter &) = delete;
+    ImageWriter &operator=(const ImageWriter &) = delete;
+    ~ImageWriter() { finish(); }
+
+    // Pixels [x0, x1) * [y0, y1) are final. Thread safe.
+    void tileDone(int x0, int y0, int x1, int y1);
+    // Whether the writer reads exactly these pixels, for owners of the image to check it is still theirs.
+    bool views(const ImageView &view) const {
+        return image.base == view.base && image.width == view.width && image.height == view.height &&
+            image.rowStride == view.rowStride && image.pixelStride == view.pixelStride;
+    }
+    // Takes all pixels as final and waits until the file is complete.
+    // Returns the milliseconds spent waiting for rows still being encoded.
+    double finish();
+
+private:
+    std::string path;
+    PIC_FORMAT format;
+    ImageView image;
+    int width{ 0 }, height{ 0 };
+    std::ofstream file;
+    std::mutex mutex;
+    std::condition_variable rowsDone;
+    std::vector<int> pixelsDone;  // per row
+    int rowsReady{ 0 };  // rows [0, rowsReady) are complete
+    std::thread writer;
+
+    void writeRows();
+};
+
+// Writes a finished image, same encoders as ImageWriter.
 void outputPic(
     const std::string &filename,
     const PIC_FORMAT &f,
-    const std::vector<std::vector<Color>> &pixels
+    const ImageView &image
 );
 
-void inputQOI(const std::string &filename, std::vector<std::vector<Color>> &pixels);
\ No newline at end of file
+void inputQOI(const std::string &filename, std::vector<std::vector<Color>> &pixels);
+// Raw 8-bit RGB, rows top to bottom, without converting to Color.
+void inputQOI(const std::string &filename, int &width, int &height, std::vector<uint8_t> &rgb);
@@ -34,9 +34,10 @@ int main() {
         Cuboid(Lambertian(WHITE), 3.5) * TF(TF::RY, -15) * TF(TF::T, 2, 0, 1.5) +
         Cuboid(Lambertian(WHITE), 3.2, 7) * TF(TF::RY, 15) * TF(TF::T, -2, 0, -1);
 
-    auto pixels = camera.randerLoop(geos.prims);
-    
-    outputPic("image", PIC_FORMAT::QOI, pixels);
+    ImageWriter output("image", PIC_FORMAT::QOI, camera.film.view());
+    camera.output = &output;
+    camera.randerLoop(geos.prims);
+    output.finish();
     timeInfo(globalTimeStart);
     return 0;
 }
\ No newline at end of file
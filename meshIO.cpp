@@ -0,0 +1,301 @@
+#include "meshIO.h"
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <sstream>
+#include <unordered_map>
+
+struct OBJVertexKey {
+    int64_t p, t, n;  // 0-based, -1 when missing
+    bool operator==(const OBJVertexKey &k) const { return p == k.p && t == k.t && n == k.n; }
+};
+
+struct OBJVertexKeyHash {
+    size_t operator()(const OBJVertexKey &k) const {
+        uint64_t h{ static_cast<uint64_t>(k.p) * 0x9E3779B97F4A7C15ull };
+        h ^= static_cast<uint64_t>(k.t) + 0x7F4A7C159E3779B9ull + (h << 6) + (h >> 2);
+        h ^= static_cast<uint64_t>(k.n) + 0x94D049BB133111EBull + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h);
+    }
+};
+
+void inputOBJ(const std::string &filename, TriangleMesh &mesh) {
+    std::ifstream in(filename);
+    if (!in) throw "Cannot open OBJ file.";
+
+    // File attributes are indexed separately, mesh vertices are built from the combinations used by faces.
+    std::vector<float> positions, texcoords, normals;
+    std::unordered_map<OBJVertexKey, uint32_t, OBJVertexKeyHash> vertexIds;
+    bool anyUV{ false }, anyNormal{ false }, allNormals{ true };
+    std::vector<uint32_t> polygon;
+
+    auto resolve = [](long i, size_t count) -> int64_t {
+        // 1-based, or negative counting back from the latest record.
+        if (i > 0) return i - 1 < static_cast<long>(count) ? i - 1 : -1;
+        if (i < 0) return static_cast<int64_t>(count) + i >= 0 ? static_cast<int64_t>(count) + i : -1;
+        return -1;
+    };
+
+    std::string line;
+    while (std::getline(in, line)) {
+        const char *c{ line.c_str() };
+        while (*c == ' ' || *c == '\t') ++c;
+        char *end;
+        if (c[0] == 'v' && (c[1] == ' ' || c[1] == '\t')) {
+            c += 2;
+            for (int i{ 0 }; i < 3; ++i, c = end) positions.push_back(std::strtof(c, &end));
+        } else if (c[0] == 'v' && c[1] == 't') {
+            c += 2;
+            for (int i{ 0 }; i < 2; ++i, c = end) texcoords.push_back(std::strtof(c, &end));
+        } else if (c[0] == 'v' && c[1] == 'n') {
+            c += 2;
+            for (int i{ 0 }; i < 3; ++i, c = end) normals.push_back(std::strtof(c, &end));
+        } else if (c[0] == 'f' && (c[1] == ' ' || c[1] == '\t')) {
+            c += 2;
+            polygon.clear();
+            while (true) {
+                long p{ std::strtol(c, &end, 10) };
+                if (end == c) break;
+                c = end;
+                long t{ 0 }, n{ 0 };
+                // strtol skips whitespace, so only read an index that directly follows the slash.
+                auto isIndex = [](char ch) { return ch == '-' || (ch >= '0' && ch <= '9'); };
+                if (*c == '/') {
+                    ++c;
+                    if (isIndex(*c)) { t = std::strtol(c, &end, 10); c = end; }
+                    if (*c == '/' && isIndex(c[1])) { n = std::strtol(c + 1, &end, 10); c = end; }
+                    else if (*c == '/') ++c;
+                }
+                OBJVertexKey key{
+                    resolve(p, positions.size() / 3), resolve(t, texcoords.size() / 2), resolve(n, normals.size() / 3) };
+                if (key.p < 0) throw "OBJ face refers to a missing vertex.";
+                if (t && key.t < 0) throw "OBJ face refers to a missing texture coordinate.";
+                if (n && key.n < 0) throw "OBJ face refers to a missing normal.";
+
+                auto found = vertexIds.find(key);
+                if (found == vertexIds.end()) {
+                    uint32_t id{ static_cast<uint32_t>(mesh.px.size()) };
+                    found = vertexIds.emplace(key, id).first;
+                    mesh.px.push_back(positions[key.p * 3]);
+                    mesh.py.push_back(positions[key.p * 3 + 1]);
+                    mesh.pz.push_back(positions[key.p * 3 + 2]);
+                    // Keep uv and normal arrays as long as positions, dropped below if never used.
+                    mesh.u.push_back(key.t < 0 ? 0.0f : texcoords[key.t * 2]);
+                    mesh.v.push_back(key.t < 0 ? 0.0f : texcoords[key.t * 2 + 1]);
+                    mesh.nx.push_back(key.n < 0 ? 0.0f : normals[key.n * 3]);
+                    mesh.ny.push_back(key.n < 0 ? 0.0f : normals[key.n * 3 + 1]);
+                    mesh.nz.push_back(key.n < 0 ? 0.0f : normals[key.n * 3 + 2]);
+                    anyUV = anyUV || key.t >= 0;
+                    anyNormal = anyNormal || key.n >= 0;
+                    allNormals = allNormals && key.n >= 0;
+                }
+                polygon.push_back(found->second);
+            }
+            for (size_t i{ 2 }; i < polygon.size(); ++i) {
+                mesh.indices.push_back(polygon[0]);
+                mesh.indices.push_back(polygon[i - 1]);
+                mesh.indices.push_back(polygon[i]);
+            }
+        }
+    }
+
+    if (!anyUV) { std::vector<float>().swap(mesh.u); std::vector<float>().swap(mesh.v); }
+    // Interpolating normals needs one at every vertex, faces without them would get a zero normal.
+    if (!anyNormal || !allNormals) { std::vector<float>().swap(mesh.nx); std::vector<float>().swap(mesh.ny); std::vector<float>().swap(mesh.nz); }
+}
+
+namespace {
+
+enum PLYType { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 };
+
+struct PLYProperty {
+    std::string name;
+    PLYType type{ FLOAT32 };
+    bool isList{ false };
+    PLYType countType{ UINT8 };  // list only
+};
+
+struct PLYElement {
+    std::string name;
+    size_t count{ 0 };
+    std::vector<PLYProperty> properties;
+};
+
+PLYType plyType(const std::string &name) {
+    if (name == "char" || name == "int8") return INT8;
+    if (name == "uchar" || name == "uint8") return UINT8;
+    if (name == "short" || name == "int16") return INT16;
+    if (name == "ushort" || name == "uint16") return UINT16;
+    if (name == "int" || name == "int32") return INT32;
+    if (name == "uint" || name == "uint32") return UINT32;
+    if (name == "float" || name == "float32") return FLOAT32;
+    if (name == "double" || name == "float64") return FLOAT64;
+    throw "Unknown PLY property type.";
+}
+
+int plySize(PLYType type) {
+    static const int sizes[]{ 1, 1, 2, 2, 4, 4, 4, 8 };
+    return sizes[type];
+}
+
+struct PLYReader {
+    // Buffered binary reader, the file is streamed in 1 MiB blocks.
+    std::ifstream &in;
+    bool bigEndian{ false };
+    std::vector<char> buffer = std::vector<char>(1 << 20);
+    size_t position{ 0 }, size{ 0 };
+
+    PLYReader(std::ifstream &stream, bool big) : in(stream), bigEndian(big) {}
+
+    void read(char *dst, int bytes) {
+        if (size - position < static_cast<size_t>(bytes)) {
+            // Move the tail to the front and refill.
+            std::memmove(buffer.data(), buffer.data() + position, size - position);
+            size -= position;
+            position = 0;
+            in.read(buffer.data() + size, buffer.size() - size);
+            size += static_cast<size_t>(in.gcount());
+            if (size < static_cast<size_t>(bytes)) throw "Unexpected end of PLY file.";
+        }
+        if (bigEndian) for (int i{ 0 }; i < bytes; ++i) dst[i] = buffer[position + bytes - 1 - i];
+        else std::memcpy(dst, buffer.data() + position, bytes);
+        position += bytes;
+    }
+
+    double value(PLYType type) {
+        char raw[8];
+        read(raw, plySize(type));
+        switch (type) {
+        case INT8: { int8_t x; std::memcpy(&x, raw, 1); return x; }
+        case UINT8: { uint8_t x; std::memcpy(&x, raw, 1); return x; }
+        case INT16: { int16_t x; std::memcpy(&x, raw, 2); return x; }
+        case UINT16: { uint16_t x; std::memcpy(&x, raw, 2); return x; }
+        case INT32: { int32_t x; std::memcpy(&x, raw, 4); return x; }
+        case UINT32: { uint32_t x; std::memcpy(&x, raw, 4); return x; }
+        case FLOAT32: { float x; std::memcpy(&x, raw, 4); return x; }
+        default: { double x; std::memcpy(&x, raw, 8); return x; }
+        }
+    }
+};
+
+uint32_t plyListCount(double count) {
+    // Count types may be signed or floating point, only values that fit are converted.
+    if (!(count >= 0.0 && count <= UINT32_MAX)) throw "Broken PLY list count.";
+    return static_cast<uint32_t>(count);
+}
+
+}
+
+void inputPLY(const std::string &filename, TriangleMesh &mesh) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) throw "Cannot open PLY file.";
+
+    std::string line;
+    std::getline(in, line);
+    if (line.compare(0, 3, "ply")) throw "Not a PLY file.";
+    bool bigEndian{ false };
+    std::vector<PLYElement> elements;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "format") {
+            std::string format;
+            words >> format;
+            if (format == "binary_big_endian") bigEndian = true;
+            else if (format != "binary_little_endian") throw "Only binary PLY is supported.";
+        } else if (keyword == "element") {
+            elements.emplace_back();
+            words >> elements.back().name >> elements.back().count;
+        } else if (keyword == "property") {
+            if (elements.empty()) throw "PLY property outside of an element.";
+            PLYProperty property;
+            std::string type;
+            words >> type;
+            if (type == "list") {
+                std::string countType, itemType;
+                words >> countType >> itemType;
+                property.isList = true;
+                property.countType = plyType(countType);
+                property.type = plyType(itemType);
+            } else property.type = plyType(type);
+            words >> property.name;
+            elements.back().properties.push_back(property);
+        } else if (keyword == "end_header") break;
+    }
+
+    PLYReader reader(in, bigEndian);
+    uint32_t firstVertex{ static_cast<uint32_t>(mesh.px.size()) };
+    double vertexCount{ 0.0 };
+    for (const auto &element : elements) if (element.name == "vertex") vertexCount += element.count;
+    std::vector<uint32_t> polygon;
+    for (const auto &element : elements) {
+        bool isVertex{ element.name == "vertex" }, isFace{ element.name == "face" };
+        if (isVertex) {
+            // Vertex attribute destination per property, nullptr to skip.
+            std::vector<std::vector<float> *> targets;
+            for (const auto &p : element.properties) {
+                std::vector<float> *target{ nullptr };
+                if (p.name == "x") target = &mesh.px;
+                else if (p.name == "y") target = &mesh.py;
+                else if (p.name == "z") target = &mesh.pz;
+                else if (p.name == "nx") target = &mesh.nx;
+                else if (p.name == "ny") target = &mesh.ny;
+                else if (p.name == "nz") target = &mesh.nz;
+                else if (p.name == "u" || p.name == "s" || p.name == "texture_u") target = &mesh.u;
+                else if (p.name == "v" || p.name == "t" || p.name == "texture_v") target = &mesh.v;
+                targets.push_back(target);
+            }
+            for (auto *target : targets) if (target) target->reserve(target->size() + element.count);
+            for (size_t i{ 0 }; i < element.count; ++i) {
+                for (size_t j{ 0 }; j < element.properties.size(); ++j) {
+                    const PLYProperty &p{ element.properties[j] };
+                    if (p.isList) {
+                        uint32_t count{ plyListCount(reader.value(p.countType)) };
+                        for (uint32_t k{ 0 }; k < count; ++k) reader.value(p.type);
+                    } else {
+                        double x{ reader.value(p.type) };
+                        if (targets[j]) targets[j]->push_back(static_cast<float>(x));
+                    }
+                }
+            }
+            if (mesh.py.size() != mesh.px.size() || mesh.pz.size() != mesh.px.size()) throw "PLY vertex lacks x, y or z.";
+        } else {
+            for (size_t i{ 0 }; i < element.count; ++i) {
+                for (const auto &p : element.properties) {
+                    bool isIndices{ isFace && (p.name == "vertex_indices" || p.name == "vertex_index") };
+                    if (!p.isList) { reader.value(p.type); continue; }
+                    uint32_t count{ plyListCount(reader.value(p.countType)) };
+                    polygon.clear();
+                    for (uint32_t k{ 0 }; k < count; ++k) {
+                        double index{ reader.value(p.type) };
+                        if (!isIndices) continue;
+                        // Checked while still a double, converting one out of range is undefined.
+                        if (!(index >= 0.0 && index < vertexCount)) throw "PLY face refers to a missing vertex.";
+                        polygon.push_back(firstVertex + static_cast<uint32_t>(index));
+                    }
+                    for (size_t k{ 2 }; k < polygon.size(); ++k) {
+                        mesh.indices.push_back(polygon[0]);
+                        mesh.indices.push_back(polygon[k - 1]);
+                        mesh.indices.push_back(polygon[k]);
+                    }
+                }
+            }
+        }
+    }
+    for (uint32_t index : mesh.indices) if (index >= mesh.px.size()) throw "PLY face refers to a missing vertex.";
+    // Intersection reads normals and uv at every vertex once nx or u are there at all.
+    size_t normals{ mesh.nx.empty() ? 0 : mesh.px.size() }, uvs{ mesh.u.empty() ? 0 : mesh.px.size() };
+    if (mesh.nx.size() != normals || mesh.ny.size() != normals || mesh.nz.size() != normals) throw "PLY vertex lacks nx, ny or nz.";
+    if (mesh.u.size() != uvs || mesh.v.size() != uvs) throw "PLY vertex lacks u or v.";
+}
+
+void inputMesh(const std::string &filename, TriangleMesh &mesh) {
+    std::string extension{ filename.substr(filename.find_last_of('.') + 1) };
+    for (auto &c : extension) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (extension == "obj") inputOBJ(filename, mesh);
+    else if (extension == "ply") inputPLY(filename, mesh);
+    else throw "Unknown mesh file extension.";
+}
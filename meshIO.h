@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include "TriangleMesh.h"
+
+// Both loaders append to the mesh's SoA buffers directly, no per-face objects are created.
+// Polygons are fan-triangulated. Errors are thrown as const char *, like Transformation.
+
+// Wavefront OBJ: v, vt, vn and f records, negative (relative) indices allowed.
+// Each distinct v/vt/vn combination becomes one mesh vertex.
+void inputOBJ(const std::string &filename, TriangleMesh &mesh);
+
+// Binary PLY, either endianness. Reads x y z, optional nx ny nz and u v (or s t),
+// and the vertex_indices list of faces. Other elements and properties are skipped.
+void inputPLY(const std::string &filename, TriangleMesh &mesh);
+
+// Pick the loader by file extension.
+void inputMesh(const std::string &filename, TriangleMesh &mesh);
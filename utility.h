@@ -1,7 +1,8 @@
 #pragma once
-#include <random>
+#include <cmath>
 #include <ctime>
 #include <iostream>
+#include "Sampler.h"
 
 constexpr double PI{ 3.141592653589793238462643 };
 constexpr double PI_RECIPROCAL{ 1.0 / PI };
@@ -20,21 +21,9 @@ enum PALETTE : int {
     GRAY = 0x444444,
 };
 
-inline double rand01() {
-    //static std::random_device rd;
-    //static std::default_random_engine generator(rd());
-    static std::default_random_engine generator;
-    static std::uniform_real_distribution<double> distr(0.0, 1.0);
-    return distr(generator);
-}
-
-inline double rand11() {
-    //static std::random_device rd;
-    //static std::default_random_engine generator(rd());
-    static std::default_random_engine generator;
-    static std::uniform_real_distribution<double> distr(0.0001, 1.0);
-    return distr(generator);
-}
+// Draw from the calling thread's own sampler. Render code should prefer the Sampler handed to it.
+inline double rand01() { return threadSampler().rand01(); }
+inline double rand11() { return threadSampler().rand11(); }
 
 inline void timeInfo(clock_t globalTimeStart) {
     clock_t globalTimeEnd = clock();